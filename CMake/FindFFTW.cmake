@@ -3,6 +3,7 @@
 #
 #  FFTW_INCLUDES    - where to find fftw3.h
 #  FFTW_LIBRARIES   - List of libraries when using FFTW.
+#  FFTW_THREADS_LIBRARIES - List of libraries when using threaded FFTW.
 #  FFTW_FOUND       - True if FFTW found.
 
 if (FFTW_INCLUDES)
@@ -24,6 +25,14 @@ find_library (FFTWF_LIBRARIES
   NAMES fftw3f
   HINTS ${FFTW_LIB_HINT})
 
+find_library (FFTW_THREADS_LIBRARIES
+  NAMES fftw3_threads
+  HINTS ${FFTW_LIB_HINT})
+
+find_library (FFTWF_THREADS_LIBRARIES
+  NAMES fftw3f_threads
+  HINTS ${FFTW_LIB_HINT})
+
 if ((NOT FFTW_LIBRARIES) OR (NOT FFTW_INCLUDES))
   message(STATUS "Trying to find FFTW3 using LD_LIBRARY_PATH (we're desperate)...")
 
@@ -37,6 +46,14 @@ if ((NOT FFTW_LIBRARIES) OR (NOT FFTW_INCLUDES))
     NAMES fftw3f
     HINTS ${LD_LIBRARY_PATH})
 
+  find_library(FFTW_THREADS_LIBRARIES
+    NAMES fftw3_threads
+    HINTS ${LD_LIBRARY_PATH})
+
+  find_library(FFTWF_THREADS_LIBRARIES
+    NAMES fftw3f_threads
+    HINTS ${LD_LIBRARY_PATH})
+
   if (FFTW_LIBRARIES)
     get_filename_component(FFTW_LIB_DIR ${FFTW_LIBRARIES} PATH)
     string(REGEX REPLACE "/lib/?$" "/include"
@@ -51,6 +68,8 @@ endif()
 # handle the QUIETLY and REQUIRED arguments and set FFTW_FOUND to TRUE if
 # all listed variables are TRUE
 include (FindPackageHandleStandardArgs)
-find_package_handle_standard_args (FFTW DEFAULT_MSG FFTW_LIBRARIES FFTW_INCLUDES)
+find_package_handle_standard_args (FFTW DEFAULT_MSG FFTW_LIBRARIES FFTW_INCLUDES
+                                   FFTW_THREADS_LIBRARIES FFTWF_THREADS_LIBRARIES)
 
-mark_as_advanced (FFTW_LIBRARIES FFTW_INCLUDES FFTWF_LIBRARIES)
+mark_as_advanced (FFTW_LIBRARIES FFTW_INCLUDES FFTWF_LIBRARIES
+                  FFTW_THREADS_LIBRARIES FFTWF_THREADS_LIBRARIES)
@@ -0,0 +1,400 @@
+/*
+ * @file bench_noisy.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Google Benchmark suite: cpu backend kernels, Fourier transforms and the
+// SLsystem stages. Results are written as JSON to noisy_bench.json unless
+// --benchmark_out is given, e.g.
+//
+//   noisy_bench --benchmark_filter=SLsystem --benchmark_out=v1.2.json
+
+#include <complex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "src/dataStructure/dataStruct.hpp"
+#include "src/backend/cpu/backendCPU.hpp"
+#include "src/transform/transformMatrix.hpp"
+#include "src/fourier/FourierTransform.hpp"
+#include "src/shearlet/SLsystem.hpp"
+
+template <typename T>
+using complex_t = typename cpu_impl<T>::complex;
+
+// uniform in [-1, 1), same sequence on every run
+template <typename T>
+static DSmatrix<T, cpu_impl> randomMatrix(unsigned int rows, unsigned int cols) {
+
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<T> uniform(T(-1), T(1));
+    DSmatrix<T, cpu_impl> mat(rows, cols);
+    for (unsigned int k = 0; k < rows * cols; ++k)
+        mat.data()[k] = uniform(gen);
+    return mat;
+}
+
+template <typename T>
+static DSmatrix<complex_t<T>, cpu_impl> randomComplexMatrix(unsigned int rows, unsigned int cols) {
+
+    std::mt19937 gen(4321);
+    std::uniform_real_distribution<T> uniform(T(-1), T(1));
+    DSmatrix<complex_t<T>, cpu_impl> mat(rows, cols);
+    for (unsigned int k = 0; k < rows * cols; ++k)
+        mat.data()[k] = complex_t<T>(uniform(gen), uniform(gen));
+    return mat;
+}
+
+// square sizes of the image-sized kernels
+static void imageSizes(benchmark::internal::Benchmark * b) {
+
+    for (long n : {256, 512, 1024, 2048})
+        b->Arg(n);
+}
+
+// image size x number of scales of the SLsystem stages
+static void systemSizes(benchmark::internal::Benchmark * b) {
+
+    b->ArgNames({"n", "scales"});
+    for (long n : {256, 512, 1024})
+        for (long scales : {1, 2, 3})
+            b->Args({n, scales});
+}
+
+static void setBytes(benchmark::State& state, size_t bytesPerIteration) {
+
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bytesPerIteration));
+}
+
+// BACKEND KERNELS
+
+template <typename T>
+static void BM_corrComplex(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    DSmatrix<complex_t<T>, cpu_impl> a = randomComplexMatrix<T>(n, n);
+    DSmatrix<complex_t<T>, cpu_impl> b = randomComplexMatrix<T>(n, n);
+    DSmatrix<complex_t<T>, cpu_impl> c(n, n);
+    for (auto _ : state) {
+        cpu_complex_impl<T>::op::corrComplex(a.data(), b.data(), c.data(), n * n);
+        benchmark::DoNotOptimize(c.data());
+    }
+    setBytes(state, 3 * sizeof(complex_t<T>) * n * n);
+}
+BENCHMARK_TEMPLATE(BM_corrComplex, float)->Apply(imageSizes);
+BENCHMARK_TEMPLATE(BM_corrComplex, double)->Apply(imageSizes);
+
+template <typename T>
+static void BM_fftshift(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    FourierTransform<T, cpu_impl> fourier(n, n);
+    DSmatrix<complex_t<T>, cpu_impl> a = randomComplexMatrix<T>(n, n);
+    for (auto _ : state) {
+        fourier.fftshift(a);
+        benchmark::DoNotOptimize(a.data());
+    }
+    setBytes(state, 2 * sizeof(complex_t<T>) * n * n);
+}
+BENCHMARK_TEMPLATE(BM_fftshift, float)->Apply(imageSizes);
+
+template <typename T>
+static void BM_dshear(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    DSmatrix<T, cpu_impl> in = randomMatrix<T>(n, n);
+    DSmatrix<T, cpu_impl> out(n, n);
+    for (auto _ : state) {
+        dshear(in, out, 1, 1);
+        benchmark::DoNotOptimize(out.data());
+    }
+    setBytes(state, 2 * sizeof(T) * n * n);
+}
+BENCHMARK_TEMPLATE(BM_dshear, float)->Apply(imageSizes);
+
+template <typename T>
+static void BM_transpose(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    DSmatrix<T, cpu_impl> in = randomMatrix<T>(n, n);
+    DSmatrix<T, cpu_impl> out(n, n);
+    for (auto _ : state) {
+        transpose(in, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    setBytes(state, 2 * sizeof(T) * n * n);
+}
+BENCHMARK_TEMPLATE(BM_transpose, float)->Apply(imageSizes);
+
+// image n x n, filter f x f
+template <typename T>
+static void BM_convData(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    unsigned int f = state.range(1);
+    DSmatrix<T, cpu_impl> in = randomMatrix<T>(n, n);
+    DSmatrix<T, cpu_impl> filter = randomMatrix<T>(f, f);
+    DSmatrix<T, cpu_impl> out(n + f - 1, n + f - 1);
+    for (auto _ : state) {
+        cpu_complex_impl<T>::op::convData(in.data(), filter.data(), out.data(), n, n, f, f);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+BENCHMARK_TEMPLATE(BM_convData, float)->ArgNames({"n", "f"})
+    ->Args({64, 7})->Args({256, 7})->Args({256, 31});
+
+// convolve with the algorithm chosen by CONV_AUTO vs forced direct
+template <typename T>
+static void BM_convolve(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    unsigned int f = state.range(1);
+    ConvAlgorithm algorithm = static_cast<ConvAlgorithm>(state.range(2));
+    DSmatrix<T, cpu_impl> in = randomMatrix<T>(n, n);
+    DSmatrix<T, cpu_impl> filter = randomMatrix<T>(f, f);
+    DSmatrix<T, cpu_impl> out(convolve(in, filter));
+    for (auto _ : state) {
+        convolve(in, filter, &out, algorithm);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+BENCHMARK_TEMPLATE(BM_convolve, float)->ArgNames({"n", "f", "algorithm"})
+    ->Args({256, 31, CONV_AUTO})->Args({256, 31, CONV_DIRECT});
+
+template <typename T>
+static void BM_reduceNmat(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    unsigned int nMat = 16;
+    std::vector<DSmatrix<complex_t<T>, cpu_impl>> mats;
+    std::vector<DSmatrix<complex_t<T>, cpu_impl>*> ptrs;
+    for (unsigned int i = 0; i < nMat; ++i)
+        mats.push_back(randomComplexMatrix<T>(n, n));
+    for (auto& mat : mats)
+        ptrs.push_back(&mat);
+    DSmatrix<T, cpu_impl> out(n, n);
+    for (auto _ : state) {
+        reduceNmat(ptrs, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    setBytes(state, (nMat * sizeof(complex_t<T>) + sizeof(T)) * n * n);
+}
+BENCHMARK_TEMPLATE(BM_reduceNmat, float)->Arg(256)->Arg(512)->Arg(1024);
+
+template <typename T>
+static void BM_applyThreshold(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    DSmatrix<complex_t<T>, cpu_impl> coeffs = randomComplexMatrix<T>(n, n);
+    for (auto _ : state) {
+        coeffs.applyThreshold(complex_t<T>(T(0.5), T(0)));
+        benchmark::DoNotOptimize(coeffs.data());
+    }
+    setBytes(state, 2 * sizeof(complex_t<T>) * n * n);
+}
+BENCHMARK_TEMPLATE(BM_applyThreshold, float)->Apply(imageSizes);
+
+// all the coefficients of a system in one pass: 32 buffers, one rule
+template <typename T>
+static void BM_shrink(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    ThresholdRule rule = ThresholdRule(state.range(1));
+    unsigned int nBuffers = 32;
+    SLcoeffs<complex_t<T>, cpu_impl> coeffs;
+    for (unsigned int i = 0; i < nBuffers; ++i)
+        coeffs.addElement(randomComplexMatrix<T>(n, n));
+    std::vector<T> thresholds(nBuffers, T(0.1));
+    for (auto _ : state) {
+        coeffs.shrink(thresholds, rule);
+        benchmark::DoNotOptimize(coeffs.getElement(0)->data());
+    }
+    setBytes(state, 2 * sizeof(complex_t<T>) * n * n * nBuffers);
+}
+BENCHMARK_TEMPLATE(BM_shrink, float)->ArgsProduct({{256, 512},
+    {THRESHOLD_HARD, THRESHOLD_SOFT, THRESHOLD_GARROTE, THRESHOLD_FIRM}});
+
+// serial (1 thread) and split over a pool
+template <typename T>
+static void BM_matMul(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    ThreadPool pool(state.range(1));
+    DSmatrix<T, cpu_impl> a = randomMatrix<T>(n, n);
+    DSmatrix<T, cpu_impl> b = randomMatrix<T>(n, n);
+    DSmatrix<T, cpu_impl> c(n, n);
+    for (auto _ : state) {
+        matMul(a, b, c, &pool);
+        benchmark::DoNotOptimize(c.data());
+    }
+    state.counters["flops"] = benchmark::Counter(2.0 * n * n * n,
+                                                 benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_TEMPLATE(BM_matMul, float)->ArgsProduct({{64, 256, 1024}, {1, 4}})->UseRealTime();
+BENCHMARK_TEMPLATE(BM_matMul, double)->ArgsProduct({{64, 256, 1024}, {1, 4}})->UseRealTime();
+
+// FOURIER TRANSFORMS
+
+template <typename T>
+static void BM_fft(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    FourierTransform<T, cpu_impl> fourier(n, n);
+    DSmatrix<complex_t<T>, cpu_impl> a = randomComplexMatrix<T>(n, n);
+    for (auto _ : state) {
+        fourier.fft(a);
+        benchmark::DoNotOptimize(a.data());
+    }
+}
+BENCHMARK_TEMPLATE(BM_fft, float)->Apply(imageSizes);
+BENCHMARK_TEMPLATE(BM_fft, double)->Apply(imageSizes);
+
+template <typename T>
+static void BM_ifft(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    FourierTransform<T, cpu_impl> fourier(n, n);
+    DSmatrix<complex_t<T>, cpu_impl> a = randomComplexMatrix<T>(n, n);
+    for (auto _ : state) {
+        fourier.ifft(a);
+        benchmark::DoNotOptimize(a.data());
+    }
+}
+BENCHMARK_TEMPLATE(BM_ifft, float)->Apply(imageSizes);
+BENCHMARK_TEMPLATE(BM_ifft, double)->Apply(imageSizes);
+
+// SLSYSTEM
+
+template <typename T>
+static void BM_SLsystem_build(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    unsigned int scales = state.range(1);
+    for (auto _ : state) {
+        SLsystem<T, cpu_impl> shearlets(n, n, scales);
+        benchmark::DoNotOptimize(&shearlets);
+    }
+}
+BENCHMARK_TEMPLATE(BM_SLsystem_build, float)->Apply(systemSizes)->Unit(benchmark::kMillisecond);
+
+template <typename T>
+static void BM_SLsystem_decode(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    SLsystem<T, cpu_impl> shearlets(n, n, state.range(1));
+    DSmatrix<T, cpu_impl> image = randomMatrix<T>(n, n);
+    for (auto _ : state) {
+        SLcoeffs<complex_t<T>, cpu_impl> coeffs = shearlets.decode(image);
+        benchmark::DoNotOptimize(&coeffs);
+    }
+}
+BENCHMARK_TEMPLATE(BM_SLsystem_decode, float)->Apply(systemSizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SLsystem_decode, double)->Apply(systemSizes)->Unit(benchmark::kMillisecond);
+
+template <typename T>
+static void BM_SLsystem_recover(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    SLsystem<T, cpu_impl> shearlets(n, n, state.range(1));
+    DSmatrix<T, cpu_impl> image = randomMatrix<T>(n, n);
+    for (auto _ : state) {
+        // recover overwrites its coefficients: decode a fresh set untimed
+        state.PauseTiming();
+        SLcoeffs<complex_t<T>, cpu_impl> coeffs = shearlets.decode(image);
+        state.ResumeTiming();
+        DSmatrix<T, cpu_impl> recovered = shearlets.recover(coeffs);
+        benchmark::DoNotOptimize(recovered.data());
+    }
+}
+BENCHMARK_TEMPLATE(BM_SLsystem_recover, float)->Apply(systemSizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SLsystem_recover, double)->Apply(systemSizes)->Unit(benchmark::kMillisecond);
+
+// decode, threshold and recover of one image, serial and threaded
+template <typename T>
+static void BM_SLsystem_denoise(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    SLsystem<T, cpu_impl> shearlets(n, n, state.range(1));
+    shearlets.setNumThreads(state.range(2));
+    DSmatrix<T, cpu_impl> image = randomMatrix<T>(n, n);
+    SLcoeffs<complex_t<T>, cpu_impl> coeffs = shearlets.decode(image);
+    std::vector<complex_t<T>> thresholds(coeffs.size(), complex_t<T>(T(0.1), T(0)));
+    for (auto _ : state) {
+        DSmatrix<T, cpu_impl> denoised = shearlets.denoise(image, thresholds);
+        benchmark::DoNotOptimize(denoised.data());
+    }
+    state.counters["images/s"] = benchmark::Counter(1, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_TEMPLATE(BM_SLsystem_denoise, float)
+    ->ArgNames({"n", "scales", "threads"})
+    ->ArgsProduct({{256, 512, 1024}, {1, 2, 3}, {1, 4}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// sigma of one image from its finest-scale coefficients, serial and threaded
+template <typename T>
+static void BM_SLsystem_estimateNoise(benchmark::State& state) {
+
+    unsigned int n = state.range(0);
+    SLsystem<T, cpu_impl> shearlets(n, n, state.range(1));
+    shearlets.setNumThreads(state.range(2));
+    DSmatrix<T, cpu_impl> image = randomMatrix<T>(n, n);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(shearlets.estimateNoise(image));
+    state.counters["images/s"] = benchmark::Counter(1, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_TEMPLATE(BM_SLsystem_estimateNoise, float)
+    ->ArgNames({"n", "scales", "threads"})
+    ->ArgsProduct({{256, 512, 1024}, {1, 2, 3}, {1, 4}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+int main(int argc, char** argv) {
+
+    // default to JSON results next to the binary's working directory
+    std::vector<char*> args(argv, argv + argc);
+    bool hasOut = false;
+    for (int i = 1; i < argc; ++i)
+        hasOut = hasOut || std::string(argv[i]).rfind("--benchmark_out=", 0) == 0;
+    std::string out = "--benchmark_out=noisy_bench.json";
+    std::string format = "--benchmark_out_format=json";
+    if (!hasOut) {
+        args.push_back(out.data());
+        args.push_back(format.data());
+    }
+
+    int nArgs = args.size();
+    benchmark::Initialize(&nArgs, args.data());
+    if (benchmark::ReportUnrecognizedArguments(nArgs, args.data()))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
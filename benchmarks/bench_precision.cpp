@@ -0,0 +1,123 @@
+/*
+ * @file bench_precision.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Float vs double SLsystem: decode/recover throughput and reconstruction
+// error on a synthetic high-dynamic-range image
+//
+// usage: noisy_bench_precision [rows cols Nscales iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "src/shearlet/SLsystem.hpp"
+
+using namespace std::chrono;
+
+// smooth background plus point sources spanning dynamicRange decades
+static std::vector<double> makeImage(unsigned int rows, unsigned int cols, double dynamicRange) {
+
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<double> image(rows * cols);
+    for (unsigned int i = 0; i < rows; ++i)
+        for (unsigned int j = 0; j < cols; ++j)
+            image[i * cols + j] = 1.0 + 0.5 * std::sin(0.05 * i) * std::cos(0.03 * j);
+
+    unsigned int nSources = rows * cols / 256;
+    for (unsigned int s = 0; s < nSources; ++s) {
+        unsigned int k = static_cast<unsigned int>(uniform(gen) * rows * cols) % (rows * cols);
+        image[k] += std::pow(10.0, uniform(gen) * dynamicRange);
+    }
+    return image;
+}
+
+template <typename T>
+static void run(unsigned int rows, unsigned int cols, unsigned int Nscales,
+                unsigned int iterations, const std::vector<double>& reference) {
+
+    DSmatrix<T, cpu_impl> image(rows, cols);
+    for (unsigned int k = 0; k < rows * cols; ++k)
+        image.data()[k] = static_cast<T>(reference[k]);
+
+    auto t0 = steady_clock::now();
+    SLsystem<T, cpu_impl> shearlets(rows, cols, Nscales);
+    double buildMs = duration<double, std::milli>(steady_clock::now() - t0).count();
+
+    double decodeMs = 0, recoverMs = 0;
+    double maxAbs = 0, errL2 = 0, refL2 = 0;
+    for (unsigned int it = 0; it < iterations; ++it) {
+
+        auto t1 = steady_clock::now();
+        SLcoeffs<typename cpu_impl<T>::complex, cpu_impl> coeffs = shearlets.decode(image);
+        auto t2 = steady_clock::now();
+        DSmatrix<T, cpu_impl> recovered = shearlets.recover(coeffs);
+        auto t3 = steady_clock::now();
+        decodeMs  += duration<double, std::milli>(t2 - t1).count();
+        recoverMs += duration<double, std::milli>(t3 - t2).count();
+
+        if (it == 0) {
+            for (unsigned int k = 0; k < rows * cols; ++k) {
+                double diff = static_cast<double>(recovered.data()[k]) - reference[k];
+                maxAbs = std::max(maxAbs, std::abs(diff));
+                errL2 += diff * diff;
+                refL2 += reference[k] * reference[k];
+            }
+        }
+    }
+
+    std::printf("%-7s %10.1f %10.2f %10.2f %12.2f %12.3e %12.3e\n",
+                sizeof(T) == sizeof(float) ? "float" : "double",
+                buildMs, decodeMs / iterations, recoverMs / iterations,
+                1000.0 * iterations / (decodeMs + recoverMs),
+                maxAbs, std::sqrt(errL2 / refL2));
+}
+
+int main(int argc, char** argv) {
+
+    unsigned int rows       = argc > 1 ? std::atoi(argv[1]) : 256;
+    unsigned int cols       = argc > 2 ? std::atoi(argv[2]) : 256;
+    unsigned int Nscales    = argc > 3 ? std::atoi(argv[3]) : 2;
+    unsigned int iterations = argc > 4 ? std::atoi(argv[4]) : 5;
+
+    std::vector<double> reference = makeImage(rows, cols, 6.0);
+
+    std::printf("%u x %u, %u scales, %u iterations\n", rows, cols, Nscales, iterations);
+    std::printf("%-7s %10s %10s %10s %12s %12s %12s\n",
+                "", "build ms", "decode ms", "recover ms", "images/s", "max abs err", "rel L2 err");
+    run<float>(rows, cols, Nscales, iterations, reference);
+    run<double>(rows, cols, Nscales, iterations, reference);
+
+    return 0;
+}
@@ -34,6 +34,8 @@
 #include <array>
 
 #include "src/backend/cpu/backendCPUfourier.hpp"
+#include "src/transform/ThresholdParams.hpp"
+#include "src/utils/threadPool.hpp"
 
 template <typename Tdata>
 class cpu_impl {
@@ -62,6 +64,21 @@ public:
     static void copy_d2h(Tdata* dst, Tdata *src, unsigned int size);
     static void copy_h2d(Tdata* dst, Tdata *src, unsigned int size);
     static void fill(Tdata * __restrict__ data, unsigned int size, Tdata value);
+    // rows x cols strided copy / fill, element (i, j) at i*rowStride + j*colStride
+    static void copyStrided(Tdata       * __restrict__ dst         ,
+                            long int                   dstRowStride,
+                            long int                   dstColStride,
+                            const Tdata * __restrict__ src         ,
+                            long int                   srcRowStride,
+                            long int                   srcColStride,
+                            unsigned int               rows        ,
+                            unsigned int               cols        );
+    static void fillStrided(Tdata * __restrict__ data     ,
+                            long int             rowStride,
+                            long int             colStride,
+                            unsigned int         rows     ,
+                            unsigned int         cols     ,
+                            Tdata                value    );
 };
 
 template <typename Tdata>
@@ -95,6 +112,13 @@ public:
     static void applyThreshold(Tdata        * __restrict__ inData   ,
                                Tdata                       threshold,
                                unsigned int                size     );
+    // shrinkage by the magnitudes of threshold and, for firm shrinkage,
+    // threshold2 (larger)
+    static void shrink(Tdata         * __restrict__ inData    ,
+                       unsigned int                 size      ,
+                       ThresholdRule                rule      ,
+                       Tdata                        threshold ,
+                       Tdata                        threshold2);
 };
 
 template <typename Tdata>
@@ -120,6 +144,27 @@ public:
                     unsigned int         nCols,
                     unsigned int         mRows,
                     unsigned int         mCols);
+    static void crop(Tdata * __restrict__ in   ,
+                     Tdata * __restrict__ out  ,
+                     unsigned int         row  ,
+                     unsigned int         col  ,
+                     unsigned int         nRows,
+                     unsigned int         nCols,
+                     unsigned int         mRows,
+                     unsigned int         mCols);
+    static void embed(Tdata * __restrict__ in   ,
+                      Tdata * __restrict__ out  ,
+                      unsigned int         row  ,
+                      unsigned int         col  ,
+                      unsigned int         nRows,
+                      unsigned int         nCols,
+                      unsigned int         mRows,
+                      unsigned int         mCols);
+    static void support(Tdata * __restrict__ in       ,
+                        Tdata                tolerance,
+                        unsigned int         mRows    ,
+                        unsigned int         mCols    ,
+                        unsigned int         box[4]   );
     static void dshear(Tdata * __restrict__ inData ,
                        Tdata * __restrict__ outData,
                        long int             k      ,
@@ -139,7 +184,8 @@ public:
                        unsigned int inRowsL,
                        unsigned int inColsL,
                        unsigned int inRowsR,
-                       unsigned int inColsR);
+                       unsigned int inColsR,
+                       ThreadPool * pool = nullptr);
 };
 
 template <typename Tdata>
@@ -162,12 +208,30 @@ public:
                             std::complex<Tdata> * __restrict__ dataIn2,
                             std::complex<Tdata> * __restrict__ dataOut,
                             unsigned int size);
+    // dataIn2 holds only the box (bRow, bCol, bRows, bCols) of a
+    // mRows x mCols matrix which is zero elsewhere; the box may wrap around
+    // the matrix edges (bRow + bRows > mRows or bCol + bCols > mCols)
+    static void corrComplexBox(std::complex<Tdata> * __restrict__ dataIn1,
+                               std::complex<Tdata> * __restrict__ dataIn2,
+                               std::complex<Tdata> * __restrict__ dataOut,
+                               unsigned int mRows, unsigned int mCols,
+                               unsigned int bRow , unsigned int bCol ,
+                               unsigned int bRows, unsigned int bCols);
+    static void convComplexBox(std::complex<Tdata> * __restrict__ dataIn1,
+                               std::complex<Tdata> * __restrict__ dataIn2,
+                               std::complex<Tdata> * __restrict__ dataOut,
+                               unsigned int mRows, unsigned int mCols,
+                               unsigned int bRow , unsigned int bCol ,
+                               unsigned int bRows, unsigned int bCols);
     static void padMatrix(Tdata * __restrict__ dataIn ,
                           Tdata * __restrict__ dataOut,
                           unsigned int         inRows ,
                           unsigned int         inCols ,
                           unsigned int         outRows,
                           unsigned int         outCols);
+    // full (mRows + fRows - 1) x (mCols + fCols - 1) linear convolution
+    // of unpadded operands, direct or as a column pass (colFilter, fRows
+    // taps) after a row pass (rowFilter, fCols taps)
     static void convData(Tdata * __restrict__ dataIn ,
                          Tdata * __restrict__ filter ,
                          Tdata * __restrict__ dataOut,
@@ -175,6 +239,21 @@ public:
                          unsigned int         mCols  ,
                          unsigned int         fRows  ,
                          unsigned int         fCols  );
+    static void convSeparable(Tdata * __restrict__ dataIn   ,
+                              Tdata * __restrict__ colFilter,
+                              Tdata * __restrict__ rowFilter,
+                              Tdata * __restrict__ dataOut  ,
+                              unsigned int         mRows    ,
+                              unsigned int         mCols    ,
+                              unsigned int         fRows    ,
+                              unsigned int         fCols    );
+    // factor filter = colFilter * rowFilter^T when it has rank one (up to
+    // rounding); returns false otherwise
+    static bool separable(Tdata * __restrict__ filter   ,
+                          Tdata * __restrict__ colFilter,
+                          Tdata * __restrict__ rowFilter,
+                          unsigned int         fRows    ,
+                          unsigned int         fCols    );
 
     static void real2complex(Tdata               * __restrict__ dataIn ,
                              std::complex<Tdata> * __restrict__ dataOut,
@@ -28,11 +28,15 @@
  */
 
 #include "src/backend/cpu/backendCPU.hpp"
+#include "src/backend/cpu/backendCPUsimd.hpp"
 #include "src/utils/utils.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cassert>
 #include <cstring>
+#include <limits>
+#include <vector>
 
 template <typename Tdata>
 void cpu_complex_impl<Tdata>::op::corrComplex(std::complex<Tdata> * __restrict__ dataIn1,
@@ -40,8 +44,9 @@ void cpu_complex_impl<Tdata>::op::corrComplex(std::complex<Tdata> * __restrict__
                                               std::complex<Tdata> * __restrict__ dataOut,
                                               unsigned int size) {
 
-    for (unsigned int i = 0; i < size; ++i)
-        dataOut[i] = dataIn1[i] * std::conj(dataIn2[i]);
+    static const cpu::details::complex_kernel<Tdata> kernel =
+        cpu::details::corrKernel<Tdata>(cpu::details::simdLevel());
+    kernel(dataIn1, dataIn2, dataOut, size);
 }
 
 template <typename Tdata>
@@ -50,8 +55,72 @@ void cpu_complex_impl<Tdata>::op::convComplex(std::complex<Tdata> * __restrict__
                                               std::complex<Tdata> * __restrict__ dataOut,
                                               unsigned int size) {
 
-    for (unsigned int i = 0; i < size; ++i)
-        dataOut[i] = dataIn1[i] * dataIn2[i];
+    static const cpu::details::complex_kernel<Tdata> kernel =
+        cpu::details::convKernel<Tdata>(cpu::details::simdLevel());
+    kernel(dataIn1, dataIn2, dataOut, size);
+}
+
+// out = in1 (op) in2 on the (possibly wrapping) box, zero elsewhere
+template <typename Tdata>
+static void boxProduct(cpu::details::complex_kernel<Tdata> kernel,
+                       const std::complex<Tdata> * __restrict__ dataIn1,
+                       const std::complex<Tdata> * __restrict__ dataIn2,
+                       std::complex<Tdata> * __restrict__ dataOut,
+                       unsigned int mRows, unsigned int mCols,
+                       unsigned int bRow , unsigned int bCol ,
+                       unsigned int bRows, unsigned int bCols) {
+
+    assert(bRow < mRows && bRows <= mRows);
+    assert(bCol < mCols && bCols <= mCols);
+
+    // columns before the right edge and wrapped to the left edge
+    unsigned int cols1 = std::min(bCols, mCols - bCol);
+    unsigned int cols2 = bCols - cols1;
+
+    for (unsigned int i = 0; i < mRows; ++i) {
+
+        std::complex<Tdata> * __restrict__ out = dataOut + i * mCols;
+        unsigned int bi = (i + mRows - bRow) % mRows;
+        if (bi >= bRows) {
+            std::fill_n(out, mCols, std::complex<Tdata>(0));
+            continue;
+        }
+
+        const std::complex<Tdata> * __restrict__ in1 = dataIn1 + i * mCols;
+        const std::complex<Tdata> * __restrict__ in2 = dataIn2 + bi * bCols;
+        kernel(in1, in2 + cols1, out, cols2);
+        std::fill_n(out + cols2, bCol - cols2, std::complex<Tdata>(0));
+        kernel(in1 + bCol, in2, out + bCol, cols1);
+        std::fill_n(out + bCol + cols1, mCols - bCol - cols1, std::complex<Tdata>(0));
+    }
+}
+
+template <typename Tdata>
+void cpu_complex_impl<Tdata>::op::corrComplexBox(std::complex<Tdata> * __restrict__ dataIn1,
+                                                 std::complex<Tdata> * __restrict__ dataIn2,
+                                                 std::complex<Tdata> * __restrict__ dataOut,
+                                                 unsigned int mRows, unsigned int mCols,
+                                                 unsigned int bRow , unsigned int bCol ,
+                                                 unsigned int bRows, unsigned int bCols) {
+
+    static const cpu::details::complex_kernel<Tdata> kernel =
+        cpu::details::corrKernel<Tdata>(cpu::details::simdLevel());
+
+    boxProduct(kernel, dataIn1, dataIn2, dataOut, mRows, mCols, bRow, bCol, bRows, bCols);
+}
+
+template <typename Tdata>
+void cpu_complex_impl<Tdata>::op::convComplexBox(std::complex<Tdata> * __restrict__ dataIn1,
+                                                 std::complex<Tdata> * __restrict__ dataIn2,
+                                                 std::complex<Tdata> * __restrict__ dataOut,
+                                                 unsigned int mRows, unsigned int mCols,
+                                                 unsigned int bRow , unsigned int bCol ,
+                                                 unsigned int bRows, unsigned int bCols) {
+
+    static const cpu::details::complex_kernel<Tdata> kernel =
+        cpu::details::convKernel<Tdata>(cpu::details::simdLevel());
+
+    boxProduct(kernel, dataIn1, dataIn2, dataOut, mRows, mCols, bRow, bCol, bRows, bCols);
 }
 
 template <typename Tdata>
@@ -77,7 +146,8 @@ void cpu_complex_impl<Tdata>::op::padMatrix(Tdata * __restrict__ dataIn ,
     }
 }
 
-// dataIn and filter are assumed to be padded
+// scatter form: every input sample adds a scaled copy of the filter, so
+// the innermost loop runs over contiguous filter and output entries
 template <typename Tdata>
 void cpu_complex_impl<Tdata>::op::convData(Tdata * __restrict__ dataIn ,
                                            Tdata * __restrict__ filter ,
@@ -90,26 +160,109 @@ void cpu_complex_impl<Tdata>::op::convData(Tdata * __restrict__ dataIn ,
     unsigned int rows = mRows + fRows - 1;
     unsigned int cols = mCols + fCols - 1;
 
-    for (unsigned int i = 0; i < rows; ++i) {
-        Tdata * __restrict__ out = dataOut + i*cols;
-        for (unsigned int j = 0; j < cols; ++j) {
-            out[j] = 0;
+    std::fill(dataOut, dataOut + rows * cols, Tdata(0));
+
+    for (unsigned int mr = 0; mr < mRows; ++mr) {
+        const Tdata * __restrict__ in = dataIn + mr * mCols;
+        for (unsigned int fr = 0; fr < fRows; ++fr) {
+            const Tdata * __restrict__ f = filter + fr * fCols;
+            Tdata * __restrict__ out = dataOut + (mr + fr) * cols;
+            for (unsigned int mc = 0; mc < mCols; ++mc) {
+                Tdata value = in[mc];
+                for (unsigned int fc = 0; fc < fCols; ++fc)
+                    out[mc + fc] += value * f[fc];
+            }
         }
     }
+}
+
+template <typename Tdata>
+void cpu_complex_impl<Tdata>::op::convSeparable(Tdata * __restrict__ dataIn   ,
+                                                Tdata * __restrict__ colFilter,
+                                                Tdata * __restrict__ rowFilter,
+                                                Tdata * __restrict__ dataOut  ,
+                                                unsigned int         mRows    ,
+                                                unsigned int         mCols    ,
+                                                unsigned int         fRows    ,
+                                                unsigned int         fCols    ) {
 
-    for (unsigned int nr = 0; nr < rows; ++nr) {
-        unsigned int low_mr = std::max((int)0, (int)nr - (int)fRows + 1);
-        unsigned int high_mr = std::min((int)mRows - 1, (int)nr);
-        for (unsigned int nc = 0; nc < cols; ++nc) {
-            unsigned int low_mc = std::max((int)0, (int)nc - (int)fCols + 1);
-            unsigned int high_mc = std::min((int)mCols - 1 , (int)nc);
-            Tdata tmp = 0;
-            for (unsigned int mr = low_mr; mr <= high_mr; ++mr)
-                for (unsigned int mc = low_mc; mc <= high_mc; ++mc)
-                    tmp += dataIn[mr * cols + mc] * filter[(nr-mr) * cols + (nc-mc)];
-            dataOut[nr * cols + nc] = tmp;
+    unsigned int rows = mRows + fRows - 1;
+    unsigned int cols = mCols + fCols - 1;
+
+    // a single column tap is folded into the row pass, which then writes
+    // the output directly
+    std::vector<Tdata> rowTaps(rowFilter, rowFilter + fCols);
+    std::vector<Tdata> rowPass;
+    Tdata * tmp = dataOut;
+    if (fRows == 1) {
+        for (Tdata& tap : rowTaps)
+            tap *= colFilter[0];
+    } else {
+        rowPass.resize(mRows * cols);
+        tmp = rowPass.data();
+    }
+
+    std::fill(tmp, tmp + mRows * cols, Tdata(0));
+    for (unsigned int mr = 0; mr < mRows; ++mr) {
+        const Tdata * __restrict__ in = dataIn + mr * mCols;
+        Tdata * __restrict__ out = tmp + mr * cols;
+        for (unsigned int mc = 0; mc < mCols; ++mc) {
+            Tdata value = in[mc];
+            for (unsigned int fc = 0; fc < fCols; ++fc)
+                out[mc + fc] += value * rowTaps[fc];
         }
     }
+
+    if (fRows == 1)
+        return;
+
+    std::fill(dataOut, dataOut + rows * cols, Tdata(0));
+    for (unsigned int mr = 0; mr < mRows; ++mr) {
+        const Tdata * __restrict__ in = tmp + mr * cols;
+        for (unsigned int fr = 0; fr < fRows; ++fr) {
+            Tdata tap = colFilter[fr];
+            Tdata * __restrict__ out = dataOut + (mr + fr) * cols;
+            for (unsigned int c = 0; c < cols; ++c)
+                out[c] += tap * in[c];
+        }
+    }
+}
+
+// rank one test against the largest entry (p, q):
+// f(i, j) * f(p, q) == f(i, q) * f(p, j) for every (i, j)
+template <typename Tdata>
+bool cpu_complex_impl<Tdata>::op::separable(Tdata * __restrict__ filter   ,
+                                            Tdata * __restrict__ colFilter,
+                                            Tdata * __restrict__ rowFilter,
+                                            unsigned int         fRows    ,
+                                            unsigned int         fCols    ) {
+
+    unsigned int size = fRows * fCols;
+    unsigned int pivot = 0;
+    for (unsigned int k = 1; k < size; ++k)
+        if (std::abs(filter[k]) > std::abs(filter[pivot]))
+            pivot = k;
+    unsigned int p = pivot / fCols;
+    unsigned int q = pivot % fCols;
+    Tdata fpq = filter[pivot];
+
+    if (fpq == Tdata(0)) {
+        std::fill(colFilter, colFilter + fRows, Tdata(0));
+        std::fill(rowFilter, rowFilter + fCols, Tdata(0));
+        return true;
+    }
+
+    Tdata tolerance = 16 * std::numeric_limits<Tdata>::epsilon() * fpq * fpq;
+    for (unsigned int i = 0; i < fRows; ++i)
+        for (unsigned int j = 0; j < fCols; ++j)
+            if (std::abs(filter[i * fCols + j] * fpq - filter[i * fCols + q] * filter[p * fCols + j]) > tolerance)
+                return false;
+
+    for (unsigned int i = 0; i < fRows; ++i)
+        colFilter[i] = filter[i * fCols + q];
+    for (unsigned int j = 0; j < fCols; ++j)
+        rowFilter[j] = filter[p * fCols + j] / fpq;
+    return true;
 }
 
 template <typename Tdata>
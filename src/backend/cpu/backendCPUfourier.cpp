@@ -31,34 +31,111 @@
 
 #include "src/utils/utils.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <mutex>
 
 namespace cpu {
 
     namespace details {
 
+        // the FFTW planner and wisdom are process-wide and not thread-safe
+        static std::mutex s_plannerMutex;
+        // guards the plan caches; always taken before s_plannerMutex
+        static std::mutex s_cacheMutex;
+
+        static unsigned int plannerFlags(FFTRigor rigor)
+        {
+            switch (rigor) {
+                case FFT_MEASURE:    return FFTW_MEASURE;
+                case FFT_PATIENT:    return FFTW_PATIENT;
+                case FFT_EXHAUSTIVE: return FFTW_EXHAUSTIVE;
+                default:             return FFTW_ESTIMATE;
+            }
+        }
+
+        // circular shift by (shiftRows, shiftCols) in place:
+        // data(i, j) <- data(i - shiftRows, j - shiftCols)
+        template<typename U>
+        static void roll(U * data, unsigned int rows, unsigned int cols,
+                         unsigned int shiftRows, unsigned int shiftCols)
+        {
+
+            if (shiftCols != 0)
+                for (unsigned int i = 0; i < rows; ++i)
+                    std::rotate(data + i * cols, data + i * cols + cols - shiftCols, data + (i + 1) * cols);
+
+            // whole rows move together
+            if (shiftRows != 0)
+                std::rotate(data, data + (size_t)(rows - shiftRows) * cols, data + (size_t)rows * cols);
+        }
+
+        // same out of place: every row is copied with two contiguous copies
+        template<typename U>
+        static void roll(const U * in, U * out, unsigned int rows, unsigned int cols,
+                         unsigned int shiftRows, unsigned int shiftCols)
+        {
+
+            for (unsigned int i = 0; i < rows; ++i) {
+
+                const U * src = in + (size_t)((i + rows - shiftRows) % rows) * cols;
+                U * dst = out + (size_t)i * cols;
+                std::memcpy(dst + shiftCols, src, (cols - shiftCols) * sizeof(U));
+                std::memcpy(dst, src + cols - shiftCols, shiftCols * sizeof(U));
+            }
+        }
+
+        // fftshift moves index 0 to n / 2, ifftshift moves it back: the two
+        // differ for odd n
+        static unsigned int fftshiftOffset(unsigned int n) { return n / 2; }
+        static unsigned int ifftshiftOffset(unsigned int n) { return (n - n / 2) % n; }
+
         template<
         typename T,
         typename ComplexT,
         typename planT,
         planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
         void destroy_plan(planT),
-        void execute_dft(planT, ComplexT *, ComplexT *)
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
         >
-        fourier_impl<T, ComplexT, planT, plan_dft_2d, destroy_plan, execute_dft>::fourier_impl(unsigned int rows, unsigned int cols)
+        fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::fourier_impl(unsigned int rows, unsigned int cols, FFTRigor rigor, unsigned int nThreads)
         : m_rows(rows),
-         m_cols(cols)
+         m_cols(cols),
+         m_flags(plannerFlags(rigor)),
+         m_nThreads(nThreads)
         {
 
+            std::lock_guard<std::mutex> lock(s_plannerMutex);
+
+            // the thread count is global planner state: set it for these
+            // plans only
+            static const bool threadsReady = init_threads() != 0;
+            if (!threadsReady)
+                m_nThreads = 1;
+            plan_with_nthreads(m_nThreads);
+
             ComplexT *fmatInOut  = (ComplexT*) fftw_malloc(sizeof(ComplexT) * rows * cols);
             m_plan_inplace_fft  = plan_dft_2d(rows, cols,
                                                     fmatInOut, fmatInOut,
                                                     FFTW_FORWARD,
-                                                    FFTW_ESTIMATE) ;
+                                                    m_flags) ;
             m_plan_inplace_ifft = plan_dft_2d(rows, cols,
                                                     fmatInOut, fmatInOut,
                                                     FFTW_BACKWARD,
-                                                    FFTW_ESTIMATE) ;
+                                                    m_flags) ;
             fftw_free(fmatInOut);
 
             ComplexT *fmatIn  = (ComplexT*) fftw_malloc(sizeof(ComplexT) * rows * cols);
@@ -66,13 +143,26 @@ namespace cpu {
             m_plan_fft  = plan_dft_2d(rows, cols,
                                             fmatIn, fmatOut,
                                             FFTW_FORWARD,
-                                            FFTW_ESTIMATE) ;
+                                            m_flags) ;
             m_plan_ifft = plan_dft_2d(rows, cols,
                                             fmatIn, fmatOut,
                                             FFTW_BACKWARD,
-                                            FFTW_ESTIMATE) ;
+                                            m_flags) ;
             fftw_free(fmatIn );
             fftw_free(fmatOut);
+
+            T        *rmat = (T*) fftw_malloc(sizeof(T) * rows * cols);
+            ComplexT *cmat = (ComplexT*) fftw_malloc(sizeof(ComplexT) * rows * (cols / 2 + 1));
+            m_plan_r2c = plan_dft_r2c_2d(rows, cols,
+                                         rmat, cmat,
+                                         m_flags) ;
+            m_plan_c2r = plan_dft_c2r_2d(rows, cols,
+                                         cmat, rmat,
+                                         m_flags) ;
+            fftw_free(rmat);
+            fftw_free(cmat);
+
+            plan_with_nthreads(1);
         }
 
         template<
@@ -80,17 +170,32 @@ namespace cpu {
         typename ComplexT,
         typename planT,
         planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
         void destroy_plan(planT),
-        void execute_dft(planT, ComplexT *, ComplexT *)
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
         >
-        fourier_impl<T, ComplexT, planT, plan_dft_2d, destroy_plan, execute_dft>::~fourier_impl()
+        fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::~fourier_impl()
         {
 
-            std::cout << "Destroying plans: " << m_rows << ", " << m_cols << std::endl; 
+            std::lock_guard<std::mutex> lock(s_plannerMutex);
             destroy_plan(m_plan_inplace_fft);
             destroy_plan(m_plan_inplace_ifft);
             destroy_plan(m_plan_fft);
             destroy_plan(m_plan_ifft);
+            destroy_plan(m_plan_r2c);
+            destroy_plan(m_plan_c2r);
+            // the batched plans go with their lists, after the lock
         }
 
         template<
@@ -98,10 +203,22 @@ namespace cpu {
         typename ComplexT,
         typename planT,
         planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
         void destroy_plan(planT),
-        void execute_dft(planT, ComplexT *, ComplexT *)
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
         >
-        void fourier_impl<T, ComplexT, planT, plan_dft_2d, destroy_plan, execute_dft>::fft(std::complex<T> * data)
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::fft(std::complex<T> * data)
         {
             execute_dft( m_plan_inplace_fft,
                          reinterpret_cast<ComplexT *>(data),
@@ -113,10 +230,22 @@ namespace cpu {
         typename ComplexT,
         typename planT,
         planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
         void destroy_plan(planT),
-        void execute_dft(planT, ComplexT *, ComplexT *)
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
         >
-        void fourier_impl<T, ComplexT, planT, plan_dft_2d, destroy_plan, execute_dft>::ifft(std::complex<T> * data)
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::ifft(std::complex<T> * data)
         {
             execute_dft( m_plan_inplace_ifft,
                          reinterpret_cast<ComplexT *>(data),
@@ -128,32 +257,158 @@ namespace cpu {
         typename ComplexT,
         typename planT,
         planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
         void destroy_plan(planT),
-        void execute_dft(planT, ComplexT *, ComplexT *)
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
         >
-        void fourier_impl<T, ComplexT, planT, plan_dft_2d, destroy_plan, execute_dft>::fftshift(std::complex<T> * data)
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::fftshift(std::complex<T> * data)
         {
+            roll(data, m_rows, m_cols, fftshiftOffset(m_rows), fftshiftOffset(m_cols));
+        }
 
-            if (m_rows % 2 == 0 && m_cols % 2 == 0) {
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::fftshift(const std::complex<T> * in, std::complex<T> * out)
+        {
+            roll(in, out, m_rows, m_cols, fftshiftOffset(m_rows), fftshiftOffset(m_cols));
+        }
 
-                for (unsigned int i = 0; i < m_rows; ++i) {
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::ifftshift(std::complex<T> * data)
+        {
+            roll(data, m_rows, m_cols, ifftshiftOffset(m_rows), ifftshiftOffset(m_cols));
+        }
 
-                    std::complex<T> * in  = data + i * m_cols ;
-                    std::complex<T> * out = data + i * m_cols;
-                    for (unsigned int j = 0; j < m_cols  / 2; ++j) {
-                        _swap(out + j, in + m_cols / 2 + j);
-                    }
-                }
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::ifftshift(const std::complex<T> * in, std::complex<T> * out)
+        {
+            roll(in, out, m_rows, m_cols, ifftshiftOffset(m_rows), ifftshiftOffset(m_cols));
+        }
 
-                for (unsigned int i = 0; i < m_rows / 2; ++i) {
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        typename fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::batch_plan
+        fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::batchPlan(unsigned int howmany, int sign)
+        {
+            // released after the lock, its deleter takes it
+            batch_plan evicted;
+            std::lock_guard<std::mutex> lock(s_plannerMutex);
 
-                    std::complex<T> * in  = data + (m_rows / 2 + i) * m_cols ;
-                    std::complex<T> * out = data + i * m_cols;
-                    for (unsigned int j = 0; j < m_cols; ++j) {
-                        _swap(out + j, in + j);
-                    }
+            std::list<std::pair<unsigned int, batch_plan>>& plans =
+                sign == FFTW_FORWARD ? m_plan_batch_fft : m_plan_batch_ifft;
+            for (auto it = plans.begin(); it != plans.end(); ++it) {
+                if (it->first == howmany) {
+                    plans.splice(plans.begin(), plans, it);
+                    return plans.front().second;
                 }
             }
+
+            int n[2] = {(int) m_rows, (int) m_cols};
+            int dist = m_rows * m_cols;
+
+            ComplexT *fmatInOut  = (ComplexT*) fftw_malloc(sizeof(ComplexT) * dist * howmany);
+            plan_with_nthreads(m_nThreads);
+            planT plan = plan_many_dft(2, n, howmany,
+                                       fmatInOut, NULL, 1, dist,
+                                       fmatInOut, NULL, 1, dist,
+                                       sign, m_flags);
+            plan_with_nthreads(1);
+            fftw_free(fmatInOut);
+
+            if (plans.size() == s_batchSizes) {
+                evicted = std::move(plans.back().second);
+                plans.pop_back();
+            }
+            plans.emplace_front(howmany, batch_plan(plan, [](planT p) {
+                std::lock_guard<std::mutex> lock(s_plannerMutex);
+                destroy_plan(p);
+            }));
+            return plans.front().second;
         }
 
         template<
@@ -161,35 +416,420 @@ namespace cpu {
         typename ComplexT,
         typename planT,
         planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
         void destroy_plan(planT),
-        void execute_dft(planT, ComplexT *, ComplexT *)
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
         >
-        void fourier_impl<T, ComplexT, planT, plan_dft_2d, destroy_plan, execute_dft>::ifftshift(std::complex<T> * data)
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::fftBatch(std::complex<T> * data, unsigned int howmany)
         {
+            batch_plan plan = batchPlan(howmany, FFTW_FORWARD);
+            execute_dft( plan.get(),
+                         reinterpret_cast<ComplexT *>(data),
+                         reinterpret_cast<ComplexT *>(data));
+        }
 
-            if (m_rows % 2 == 0 && m_cols % 2 == 0) {
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::ifftBatch(std::complex<T> * data, unsigned int howmany)
+        {
+            batch_plan plan = batchPlan(howmany, FFTW_BACKWARD);
+            execute_dft( plan.get(),
+                         reinterpret_cast<ComplexT *>(data),
+                         reinterpret_cast<ComplexT *>(data));
+        }
 
-                for (unsigned int i = 0; i < m_rows; ++i) {
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::rfft(T * in, std::complex<T> * out)
+        {
+            execute_dft_r2c( m_plan_r2c, in, reinterpret_cast<ComplexT *>(out));
+        }
 
-                    std::complex<T> * in  = data + i * m_cols ;
-                    std::complex<T> * out = data + i * m_cols;
-                    for (unsigned int j = 0; j < m_cols  / 2; ++j) {
-                        _swap(out + j, in + m_cols / 2 + j);
-                    }
-                }
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::irfft(std::complex<T> * in, T * out)
+        {
+            execute_dft_c2r( m_plan_c2r, reinterpret_cast<ComplexT *>(in), out);
+        }
 
-                for (unsigned int i = 0; i < m_rows / 2; ++i) {
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::fftshift(T * data)
+        {
+            roll(data, m_rows, m_cols, fftshiftOffset(m_rows), fftshiftOffset(m_cols));
+        }
 
-                    std::complex<T> * in  = data + (m_rows / 2 + i) * m_cols ;
-                    std::complex<T> * out = data + i * m_cols;
-                    for (unsigned int j = 0; j < m_cols; ++j) {
-                        _swap(out + j, in + j);
-                    }
-                }
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::fftshift(const T * in, T * out)
+        {
+            roll(in, out, m_rows, m_cols, fftshiftOffset(m_rows), fftshiftOffset(m_cols));
+        }
+
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::ifftshift(T * data)
+        {
+            roll(data, m_rows, m_cols, ifftshiftOffset(m_rows), ifftshiftOffset(m_cols));
+        }
+
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::ifftshift(const T * in, T * out)
+        {
+            roll(in, out, m_rows, m_cols, ifftshiftOffset(m_rows), ifftshiftOffset(m_cols));
+        }
+
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::halfToFull(std::complex<T> * data)
+        {
+
+            unsigned int half = m_cols / 2 + 1;
+
+            // move the rows to their final position, last row first
+            for (unsigned int i = m_rows; i-- > 1; )
+                std::memmove(data + i * m_cols, data + i * half, half * sizeof(std::complex<T>));
+
+            // X(i, j) = conj(X(-i, -j)) for the missing columns
+            for (unsigned int i = 0; i < m_rows; ++i) {
+
+                std::complex<T> * out = data + i * m_cols;
+                std::complex<T> * in  = data + ((m_rows - i) % m_rows) * m_cols;
+                for (unsigned int j = half; j < m_cols; ++j)
+                    out[j] = std::conj(in[m_cols - j]);
+            }
+        }
+
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::fullToHalf(std::complex<T> * in, std::complex<T> * out)
+        {
+
+            unsigned int half = m_cols / 2 + 1;
+
+            for (unsigned int i = 0; i < m_rows; ++i) {
+
+                std::complex<T> * row    = in + i * m_cols;
+                std::complex<T> * mirror = in + ((m_rows - i) % m_rows) * m_cols;
+                std::complex<T> * outRow = out + i * half;
+                for (unsigned int j = 0; j < half; ++j)
+                    outRow[j] = T(0.5) * (row[j] + std::conj(mirror[(m_cols - j) % m_cols]));
             }
         }
 
-        template class fourier_impl<float, fftwf_complex, fftwf_plan, fftwf_plan_dft_2d, fftwf_destroy_plan, fftwf_execute_dft>;
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        bool fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::importWisdom(const std::string& fileName)
+        {
+            std::lock_guard<std::mutex> lock(s_plannerMutex);
+            return import_wisdom(fileName.c_str()) != 0;
+        }
+
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        bool fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::exportWisdom(const std::string& fileName)
+        {
+            std::lock_guard<std::mutex> lock(s_plannerMutex);
+            return export_wisdom(fileName.c_str()) != 0;
+        }
+
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        typename fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::cache_type& fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::cache()
+        {
+            // one cache per precision, destroyed at exit
+            static cache_type plans;
+            return plans;
+        }
+
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        std::shared_ptr<fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>> fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::instance(unsigned int rows, unsigned int cols,
+                                                FFTRigor rigor, unsigned int nThreads)
+        {
+            std::lock_guard<std::mutex> lock(s_cacheMutex);
+
+            cache_key key(rows, cols, plannerFlags(rigor), nThreads);
+            std::shared_ptr<fourier_impl>& impl = cache()[key];
+            if (!impl)
+                impl = std::make_shared<fourier_impl>(rows, cols, rigor, nThreads);
+            return impl;
+        }
+
+        template<
+        typename T,
+        typename ComplexT,
+        typename planT,
+        planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
+        >
+        void fourier_impl<T, ComplexT, planT, plan_dft_2d, plan_many_dft, plan_dft_r2c_2d, plan_dft_c2r_2d, destroy_plan, execute_dft, execute_dft_r2c, execute_dft_c2r, import_wisdom, export_wisdom, init_threads, plan_with_nthreads>::clearCache()
+        {
+            std::lock_guard<std::mutex> lock(s_cacheMutex);
+            cache().clear();
+        }
+
+        template class fourier_impl<float, fftwf_complex, fftwf_plan, fftwf_plan_dft_2d, fftwf_plan_many_dft, fftwf_plan_dft_r2c_2d, fftwf_plan_dft_c2r_2d, fftwf_destroy_plan, fftwf_execute_dft, fftwf_execute_dft_r2c, fftwf_execute_dft_c2r, fftwf_import_wisdom_from_filename, fftwf_export_wisdom_to_filename, fftwf_init_threads, fftwf_plan_with_nthreads>;
+        template class fourier_impl<double, fftw_complex, fftw_plan, fftw_plan_dft_2d, fftw_plan_many_dft, fftw_plan_dft_r2c_2d, fftw_plan_dft_c2r_2d, fftw_destroy_plan, fftw_execute_dft, fftw_execute_dft_r2c, fftw_execute_dft_c2r, fftw_import_wisdom_from_filename, fftw_export_wisdom_to_filename, fftw_init_threads, fftw_plan_with_nthreads>;
 
     }
 
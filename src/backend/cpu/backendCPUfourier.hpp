@@ -31,8 +31,17 @@
 #define BACKENDCPUFOURIER_HPP_
 
 #include <complex>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include "fftw3.h"
 
+#include "src/fourier/FourierParams.hpp"
+
 namespace cpu {
 
     namespace details {
@@ -42,37 +51,118 @@ namespace cpu {
         typename ComplexT,
         typename planT,
         planT plan_dft_2d(int, int, ComplexT*, ComplexT*, int, unsigned int),
-        void destroy_plan(planT), 
-        void execute_dft(planT, ComplexT *, ComplexT *)
+        planT plan_many_dft(int, const int*, int,
+                            ComplexT*, const int*, int, int,
+                            ComplexT*, const int*, int, int,
+                            int, unsigned int),
+        planT plan_dft_r2c_2d(int, int, T*, ComplexT*, unsigned int),
+        planT plan_dft_c2r_2d(int, int, ComplexT*, T*, unsigned int),
+        void destroy_plan(planT),
+        void execute_dft(planT, ComplexT *, ComplexT *),
+        void execute_dft_r2c(planT, T *, ComplexT *),
+        void execute_dft_c2r(planT, ComplexT *, T *),
+        int import_wisdom(const char *),
+        int export_wisdom(const char *),
+        int init_threads(),
+        void plan_with_nthreads(int)
         >
         class fourier_impl {
         private:
             unsigned int m_rows;
             unsigned int m_cols;
+            unsigned int m_flags;
+            unsigned int m_nThreads;
             planT m_plan_fft          ;
             planT m_plan_ifft         ;
             planT m_plan_inplace_fft  ;
             planT m_plan_inplace_ifft ;
+            planT m_plan_r2c          ;
+            planT m_plan_c2r          ;
+            // in-place batched plans of the last s_batchSizes batch sizes,
+            // most recent first: an evicted plan is destroyed once the
+            // transforms running on it return
+            using batch_plan = std::shared_ptr<std::remove_pointer_t<planT>>;
+            static constexpr unsigned int s_batchSizes = 8;
+            std::list<std::pair<unsigned int, batch_plan>> m_plan_batch_fft  ;
+            std::list<std::pair<unsigned int, batch_plan>> m_plan_batch_ifft ;
+
+            batch_plan batchPlan(unsigned int howmany, int sign);
+
+            using cache_key  = std::tuple<unsigned int, unsigned int, unsigned int, unsigned int>;
+            using cache_type = std::map<cache_key, std::shared_ptr<fourier_impl>>;
+            static cache_type& cache();
         public:
-            fourier_impl(unsigned int rows, unsigned int cols);
+            // plans with nThreads > 1 run each transform on nThreads threads
+            fourier_impl(unsigned int rows, unsigned int cols,
+                         FFTRigor rigor = FFT_ESTIMATE,
+                         unsigned int nThreads = 1);
             ~fourier_impl();
+
+            fourier_impl(const fourier_impl&) = delete;
+            fourier_impl& operator=(const fourier_impl&) = delete;
+
+            // Process-wide instance for the given shape and planner options:
+            // the plans are created by the first request and shared by all
+            // the following ones until clearCache
+            static std::shared_ptr<fourier_impl> instance(unsigned int rows, unsigned int cols,
+                                                          FFTRigor rigor = FFT_ESTIMATE,
+                                                          unsigned int nThreads = 1);
+            // drop the cached instances (plans still in use stay alive)
+            static void clearCache();
+            // process-wide FFTW wisdom; plans created after an import
+            // reuse it, so the rigorous planning runs only once
+            static bool importWisdom(const std::string& fileName);
+            static bool exportWisdom(const std::string& fileName);
             void fft(std::complex<T> *data);
             void ifft(std::complex<T> *data);
+            // shifts of rows x cols matrices (odd sizes included), in place
+            // or out of place (in and out must not overlap)
             void fftshift(std::complex<T> *data);
             void ifftshift(std::complex<T> *data);
+            void fftshift(const std::complex<T> *in, std::complex<T> *out);
+            void ifftshift(const std::complex<T> *in, std::complex<T> *out);
+            // transform howmany contiguous rows x cols matrices in place
+            void fftBatch(std::complex<T> *data, unsigned int howmany);
+            void ifftBatch(std::complex<T> *data, unsigned int howmany);
+            // real transforms on the half spectrum rows x (cols / 2 + 1);
+            // irfft destroys its input
+            void rfft(T *in, std::complex<T> *out);
+            void irfft(std::complex<T> *in, T *out);
+            void fftshift(T *data);
+            void ifftshift(T *data);
+            void fftshift(const T *in, T *out);
+            void ifftshift(const T *in, T *out);
+            // expand in place a half spectrum stored at the beginning of
+            // data to the full rows x cols spectrum by Hermitian symmetry
+            void halfToFull(std::complex<T> *data);
+            // half spectrum of the Hermitian part of a full spectrum, i.e.
+            // the spectrum of the real part of its inverse transform
+            void fullToHalf(std::complex<T> *in, std::complex<T> *out);
         };
 
         template<typename T> struct fourier_helper;
         template<> struct fourier_helper<float>  {
             using type = fourier_impl<float, fftwf_complex,
                                       fftwf_plan, fftwf_plan_dft_2d,
-                                      fftwf_destroy_plan, fftwf_execute_dft>;
+                                      fftwf_plan_many_dft,
+                                      fftwf_plan_dft_r2c_2d, fftwf_plan_dft_c2r_2d,
+                                      fftwf_destroy_plan, fftwf_execute_dft,
+                                      fftwf_execute_dft_r2c, fftwf_execute_dft_c2r,
+                                      fftwf_import_wisdom_from_filename,
+                                      fftwf_export_wisdom_to_filename,
+                                      fftwf_init_threads, fftwf_plan_with_nthreads>;
         };
 
         template<> struct fourier_helper<double> {
             using type = fourier_impl<double, fftw_complex,
                                       fftw_plan, fftw_plan_dft_2d,
-                                      fftw_destroy_plan, fftw_execute_dft>;
+                                      fftw_plan_many_dft,
+                                      fftw_plan_dft_r2c_2d, fftw_plan_dft_c2r_2d,
+                                      fftw_destroy_plan, fftw_execute_dft,
+                                      fftw_execute_dft_r2c, fftw_execute_dft_c2r,
+                                      fftw_import_wisdom_from_filename,
+                                      fftw_export_wisdom_to_filename,
+                                      fftw_init_threads, fftw_plan_with_nthreads>;
         };
         template<typename Tdata>
         using fourier = typename cpu::details::fourier_helper<Tdata>::type;
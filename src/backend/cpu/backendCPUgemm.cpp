@@ -0,0 +1,436 @@
+/*
+ * @file backendCPUgemm.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "src/backend/cpu/backendCPUgemm.hpp"
+#include "src/backend/cpu/backendCPUsimd.hpp"
+#include "src/utils/threadPool.hpp"
+
+#include <algorithm>
+#include <complex>
+#include <cstring>
+#include <memory>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NOISY_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#ifdef NOISY_USE_BLAS
+// Fortran interface, available in every BLAS implementation
+extern "C" {
+    void sgemm_(const char * transa, const char * transb,
+                const int * m, const int * n, const int * k,
+                const float * alpha, const float * a, const int * lda,
+                const float * b, const int * ldb,
+                const float * beta, float * c, const int * ldc);
+    void dgemm_(const char * transa, const char * transb,
+                const int * m, const int * n, const int * k,
+                const double * alpha, const double * a, const int * lda,
+                const double * b, const int * ldb,
+                const double * beta, double * c, const int * ldc);
+}
+#endif
+
+namespace cpu {
+
+    namespace details {
+
+        // MR x NR micro-tile held in registers, KC x NR panel of B in L1,
+        // MC x KC block of A in L2, KC x NC panel of B in L3
+        template <typename T>
+        struct gemm_blocking {
+            static constexpr unsigned int MR = 4;
+            static constexpr unsigned int NR = 4;
+            static constexpr unsigned int KC = 128;
+            static constexpr unsigned int MC = 64;
+            static constexpr unsigned int NC = 1024;
+        };
+
+        template <>
+        struct gemm_blocking<float> {
+            static constexpr unsigned int MR = 6;
+            static constexpr unsigned int NR = 16;
+            static constexpr unsigned int KC = 256;
+            static constexpr unsigned int MC = 96;
+            static constexpr unsigned int NC = 4096;
+        };
+
+        template <>
+        struct gemm_blocking<double> {
+            static constexpr unsigned int MR = 6;
+            static constexpr unsigned int NR = 8;
+            static constexpr unsigned int KC = 256;
+            static constexpr unsigned int MC = 96;
+            static constexpr unsigned int NC = 2048;
+        };
+
+        // below this many multiply-adds the product runs on the caller
+        static constexpr unsigned long s_parallelWork = 1UL << 21;
+        // columns of a B panel handled by one parallel task
+        static constexpr unsigned int s_taskCols = 512;
+
+        // c (MR x NR, leading dimension ldc) = or += a_panel * b_panel
+        template <typename T>
+        using gemm_kernel = void (*)(unsigned int kc, const T * __restrict__ a,
+                                     const T * __restrict__ b, T * __restrict__ c,
+                                     unsigned int ldc, bool accumulate);
+
+        template <typename T>
+        static void kernelScalar(unsigned int kc, const T * __restrict__ a,
+                                 const T * __restrict__ b, T * __restrict__ c,
+                                 unsigned int ldc, bool accumulate) {
+
+            constexpr unsigned int MR = gemm_blocking<T>::MR;
+            constexpr unsigned int NR = gemm_blocking<T>::NR;
+
+            T acc[MR][NR];
+            for (unsigned int i = 0; i < MR; ++i)
+                for (unsigned int j = 0; j < NR; ++j)
+                    acc[i][j] = T(0);
+
+            for (unsigned int p = 0; p < kc; ++p, a += MR, b += NR)
+                for (unsigned int i = 0; i < MR; ++i)
+                    for (unsigned int j = 0; j < NR; ++j)
+                        acc[i][j] += a[i] * b[j];
+
+            for (unsigned int i = 0; i < MR; ++i)
+                for (unsigned int j = 0; j < NR; ++j)
+                    c[i * ldc + j] = accumulate ? c[i * ldc + j] + acc[i][j] : acc[i][j];
+        }
+
+#ifdef NOISY_SIMD_X86
+
+        // 6 x 16 floats / 6 x 8 doubles: 12 accumulators, two B vectors and
+        // one broadcast A element per row
+
+        __attribute__((target("avx2,fma")))
+        static void kernelAVX2(unsigned int kc, const float * __restrict__ a,
+                               const float * __restrict__ b, float * __restrict__ c,
+                               unsigned int ldc, bool accumulate) {
+
+            __m256 acc[6][2];
+            for (unsigned int i = 0; i < 6; ++i)
+                acc[i][0] = acc[i][1] = _mm256_setzero_ps();
+
+            for (unsigned int p = 0; p < kc; ++p, a += 6, b += 16) {
+                __m256 b0 = _mm256_loadu_ps(b);
+                __m256 b1 = _mm256_loadu_ps(b + 8);
+                for (unsigned int i = 0; i < 6; ++i) {
+                    __m256 ai = _mm256_broadcast_ss(a + i);
+                    acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+                }
+            }
+
+            for (unsigned int i = 0; i < 6; ++i) {
+                float * row = c + i * ldc;
+                if (accumulate) {
+                    acc[i][0] = _mm256_add_ps(acc[i][0], _mm256_loadu_ps(row));
+                    acc[i][1] = _mm256_add_ps(acc[i][1], _mm256_loadu_ps(row + 8));
+                }
+                _mm256_storeu_ps(row, acc[i][0]);
+                _mm256_storeu_ps(row + 8, acc[i][1]);
+            }
+        }
+
+        __attribute__((target("avx2,fma")))
+        static void kernelAVX2(unsigned int kc, const double * __restrict__ a,
+                               const double * __restrict__ b, double * __restrict__ c,
+                               unsigned int ldc, bool accumulate) {
+
+            __m256d acc[6][2];
+            for (unsigned int i = 0; i < 6; ++i)
+                acc[i][0] = acc[i][1] = _mm256_setzero_pd();
+
+            for (unsigned int p = 0; p < kc; ++p, a += 6, b += 8) {
+                __m256d b0 = _mm256_loadu_pd(b);
+                __m256d b1 = _mm256_loadu_pd(b + 4);
+                for (unsigned int i = 0; i < 6; ++i) {
+                    __m256d ai = _mm256_broadcast_sd(a + i);
+                    acc[i][0] = _mm256_fmadd_pd(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm256_fmadd_pd(ai, b1, acc[i][1]);
+                }
+            }
+
+            for (unsigned int i = 0; i < 6; ++i) {
+                double * row = c + i * ldc;
+                if (accumulate) {
+                    acc[i][0] = _mm256_add_pd(acc[i][0], _mm256_loadu_pd(row));
+                    acc[i][1] = _mm256_add_pd(acc[i][1], _mm256_loadu_pd(row + 4));
+                }
+                _mm256_storeu_pd(row, acc[i][0]);
+                _mm256_storeu_pd(row + 4, acc[i][1]);
+            }
+        }
+
+#endif
+
+        // AVX-512 machines use the AVX2 kernel; on other architectures the
+        // scalar kernel is left to the compiler's auto-vectorizer
+        template <typename T>
+        static gemm_kernel<T> gemmKernel(SIMDLevel) {
+
+            return kernelScalar<T>;
+        }
+
+        template <>
+        gemm_kernel<float> gemmKernel<float>(SIMDLevel level) {
+
+#ifdef NOISY_SIMD_X86
+            if (level >= SIMD_AVX2)
+                return kernelAVX2;
+#endif
+            return kernelScalar<float>;
+        }
+
+        template <>
+        gemm_kernel<double> gemmKernel<double>(SIMDLevel level) {
+
+#ifdef NOISY_SIMD_X86
+            if (level >= SIMD_AVX2)
+                return kernelAVX2;
+#endif
+            return kernelScalar<double>;
+        }
+
+        // rows of A in micro-panels of MR, column by column, zero padded
+        template <typename T>
+        static void packA(const T * A, unsigned int lda,
+                          unsigned int mc, unsigned int kc, T * Ap) {
+
+            constexpr unsigned int MR = gemm_blocking<T>::MR;
+
+            for (unsigned int ir = 0; ir < mc; ir += MR) {
+                unsigned int mr = std::min(MR, mc - ir);
+                for (unsigned int p = 0; p < kc; ++p, Ap += MR) {
+                    for (unsigned int i = 0; i < mr; ++i)
+                        Ap[i] = A[(ir + i) * lda + p];
+                    for (unsigned int i = mr; i < MR; ++i)
+                        Ap[i] = T(0);
+                }
+            }
+        }
+
+        // columns of B in micro-panels of NR, row by row, zero padded
+        template <typename T>
+        static void packB(const T * B, unsigned int ldb,
+                          unsigned int kc, unsigned int nc, T * Bp) {
+
+            constexpr unsigned int NR = gemm_blocking<T>::NR;
+
+            for (unsigned int jr = 0; jr < nc; jr += NR) {
+                unsigned int nr = std::min(NR, nc - jr);
+                for (unsigned int p = 0; p < kc; ++p, Bp += NR) {
+                    const T * row = B + p * ldb + jr;
+                    for (unsigned int j = 0; j < nr; ++j)
+                        Bp[j] = row[j];
+                    for (unsigned int j = nr; j < NR; ++j)
+                        Bp[j] = T(0);
+                }
+            }
+        }
+
+        // (mc x nc) block of C from packed A and B. Edge tiles go through a
+        // full-size scratch tile, so every entry sees the same instructions
+        template <typename T>
+        static void macroKernel(gemm_kernel<T> kernel,
+                                const T * Ap, const T * Bp, T * C, unsigned int ldc,
+                                unsigned int mc, unsigned int nc, unsigned int kc,
+                                bool accumulate) {
+
+            constexpr unsigned int MR = gemm_blocking<T>::MR;
+            constexpr unsigned int NR = gemm_blocking<T>::NR;
+
+            T tile[MR * NR];
+            for (unsigned int jr = 0; jr < nc; jr += NR) {
+                unsigned int nr = std::min(NR, nc - jr);
+                for (unsigned int ir = 0; ir < mc; ir += MR) {
+                    unsigned int mr = std::min(MR, mc - ir);
+                    const T * a = Ap + ir * kc;
+                    const T * b = Bp + jr * kc;
+                    T * c = C + ir * ldc + jr;
+                    if (mr == MR && nr == NR) {
+                        kernel(kc, a, b, c, ldc, accumulate);
+                        continue;
+                    }
+                    kernel(kc, a, b, tile, NR, false);
+                    for (unsigned int i = 0; i < mr; ++i)
+                        for (unsigned int j = 0; j < nr; ++j)
+                            c[i * ldc + j] = accumulate ? c[i * ldc + j] + tile[i * NR + j]
+                                                        : tile[i * NR + j];
+                }
+            }
+        }
+
+        template <typename T>
+        void gemmNative(const T * A, const T * B, T * C,
+                        unsigned int m, unsigned int k, unsigned int n,
+                        ThreadPool * pool) {
+
+            constexpr unsigned int MR = gemm_blocking<T>::MR;
+            constexpr unsigned int NR = gemm_blocking<T>::NR;
+            constexpr unsigned int KC = gemm_blocking<T>::KC;
+            constexpr unsigned int MC = gemm_blocking<T>::MC;
+            constexpr unsigned int NC = gemm_blocking<T>::NC;
+            static_assert(MC % MR == 0 && NC % NR == 0 && s_taskCols % NR == 0,
+                          "blocks must hold whole micro-panels");
+
+            if (k == 0) {
+                std::fill(C, C + (unsigned long)m * n, T(0));
+                return;
+            }
+
+            static const gemm_kernel<T> kernel = gemmKernel<T>(simdLevel());
+
+            bool parallel = pool != nullptr && pool->size() > 1 &&
+                            (unsigned long)m * n * k >= s_parallelWork;
+            unsigned int nWorkers = parallel ? pool->size() : 1;
+
+            std::unique_ptr<T[]> Bp(new T[(unsigned long)KC * std::min(NC, (n + NR - 1) / NR * NR)]);
+            std::unique_ptr<T[]> Ap(new T[(unsigned long)nWorkers * MC * KC]);
+
+            for (unsigned int jc = 0; jc < n; jc += NC) {
+                unsigned int nc = std::min(NC, n - jc);
+                for (unsigned int pc = 0; pc < k; pc += KC) {
+                    unsigned int kc = std::min(KC, k - pc);
+                    // the first panel of k overwrites C, the others add to it
+                    bool accumulate = pc > 0;
+
+                    packB(B + (unsigned long)pc * n + jc, n, kc, nc, Bp.get());
+
+                    // tasks are (MC rows) x (s_taskCols columns) blocks of C
+                    unsigned int rowBlocks = (m + MC - 1) / MC;
+                    unsigned int colBlocks = parallel ? (nc + s_taskCols - 1) / s_taskCols : 1;
+                    unsigned int taskCols = parallel ? s_taskCols : nc;
+
+                    auto task = [&](unsigned int t, unsigned int worker) {
+                        unsigned int ic = (t / colBlocks) * MC;
+                        unsigned int jt = (t % colBlocks) * taskCols;
+                        unsigned int mc = std::min(MC, m - ic);
+                        unsigned int nt = std::min(taskCols, nc - jt);
+                        T * a = Ap.get() + (unsigned long)worker * MC * KC;
+                        packA(A + (unsigned long)ic * k + pc, k, mc, kc, a);
+                        macroKernel(kernel, a, Bp.get() + (unsigned long)jt * kc,
+                                    C + (unsigned long)ic * n + jc + jt, n,
+                                    mc, nt, kc, accumulate);
+                    };
+
+                    if (parallel)
+                        pool->parallelFor(rowBlocks * colBlocks, task);
+                    else
+                        for (unsigned int t = 0; t < rowBlocks; ++t)
+                            task(t, 0);
+                }
+            }
+        }
+
+        template <typename T>
+        void gemm(const T * A, const T * B, T * C,
+                  unsigned int m, unsigned int k, unsigned int n,
+                  ThreadPool * pool) {
+
+            gemmNative(A, B, C, m, k, n, pool);
+        }
+
+#ifdef NOISY_USE_BLAS
+        // row-major C = A * B is column-major C^T = B^T * A^T; the BLAS
+        // library runs its own threads
+
+        void gemm(const float * A, const float * B, float * C,
+                  unsigned int m, unsigned int k, unsigned int n,
+                  ThreadPool *) {
+
+            const int M = m, N = n, K = k;
+            const float one = 1.0f, zero = 0.0f;
+            if (m == 0 || n == 0)
+                return;
+            // K would be an invalid leading dimension of A
+            if (k == 0) {
+                std::fill(C, C + (unsigned long)m * n, float(0));
+                return;
+            }
+            sgemm_("N", "N", &N, &M, &K, &one, B, &N, A, &K, &zero, C, &N);
+        }
+
+        void gemm(const double * A, const double * B, double * C,
+                  unsigned int m, unsigned int k, unsigned int n,
+                  ThreadPool *) {
+
+            const int M = m, N = n, K = k;
+            const double one = 1.0, zero = 0.0;
+            if (m == 0 || n == 0)
+                return;
+            // K would be an invalid leading dimension of A
+            if (k == 0) {
+                std::fill(C, C + (unsigned long)m * n, double(0));
+                return;
+            }
+            dgemm_("N", "N", &N, &M, &K, &one, B, &N, A, &K, &zero, C, &N);
+        }
+#else
+        void gemm(const float * A, const float * B, float * C,
+                  unsigned int m, unsigned int k, unsigned int n,
+                  ThreadPool * pool) {
+
+            gemmNative(A, B, C, m, k, n, pool);
+        }
+
+        void gemm(const double * A, const double * B, double * C,
+                  unsigned int m, unsigned int k, unsigned int n,
+                  ThreadPool * pool) {
+
+            gemmNative(A, B, C, m, k, n, pool);
+        }
+#endif
+
+        template void gemmNative<float>(const float *, const float *, float *,
+                                        unsigned int, unsigned int, unsigned int, ThreadPool *);
+        template void gemmNative<double>(const double *, const double *, double *,
+                                         unsigned int, unsigned int, unsigned int, ThreadPool *);
+        template void gemmNative<std::complex<float>>(const std::complex<float> *,
+                                                      const std::complex<float> *,
+                                                      std::complex<float> *,
+                                                      unsigned int, unsigned int, unsigned int, ThreadPool *);
+        template void gemmNative<std::complex<double>>(const std::complex<double> *,
+                                                       const std::complex<double> *,
+                                                       std::complex<double> *,
+                                                       unsigned int, unsigned int, unsigned int, ThreadPool *);
+
+        template void gemm<std::complex<float>>(const std::complex<float> *,
+                                                const std::complex<float> *,
+                                                std::complex<float> *,
+                                                unsigned int, unsigned int, unsigned int, ThreadPool *);
+        template void gemm<std::complex<double>>(const std::complex<double> *,
+                                                 const std::complex<double> *,
+                                                 std::complex<double> *,
+                                                 unsigned int, unsigned int, unsigned int, ThreadPool *);
+
+    }
+
+}
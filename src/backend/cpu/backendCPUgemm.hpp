@@ -0,0 +1,71 @@
+/*
+ * @file backendCPUgemm.hpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BACKENDCPUGEMM_HPP_
+#define BACKENDCPUGEMM_HPP_
+
+#include "src/utils/threadPool.hpp"
+
+namespace cpu {
+
+    namespace details {
+
+        // C = A * B with row-major A (m x k), B (k x n) and C (m x n); C is
+        // overwritten and must not overlap A or B. The float and double
+        // overloads dispatch to BLAS when the library was built with it, to
+        // gemmNative otherwise; the template (complex types) to gemmNative.
+        // pool is only used by gemmNative
+        template <typename T>
+        void gemm(const T * A, const T * B, T * C,
+                  unsigned int m, unsigned int k, unsigned int n,
+                  ThreadPool * pool = nullptr);
+
+        void gemm(const float * A, const float * B, float * C,
+                  unsigned int m, unsigned int k, unsigned int n,
+                  ThreadPool * pool = nullptr);
+
+        void gemm(const double * A, const double * B, double * C,
+                  unsigned int m, unsigned int k, unsigned int n,
+                  ThreadPool * pool = nullptr);
+
+        // Blocked GEMM: B is packed in (KC x NC) panels, A in (MC x KC)
+        // blocks and an (MR x NR) register-blocked micro-kernel (AVX2/FMA
+        // when the CPU supports it) runs over the packed data. Large
+        // products are split over pool when given, small ones and those
+        // without a pool run on the caller
+        template <typename T>
+        void gemmNative(const T * A, const T * B, T * C,
+                        unsigned int m, unsigned int k, unsigned int n,
+                        ThreadPool * pool = nullptr);
+
+    }
+
+}
+
+#endif
@@ -28,21 +28,22 @@
  */
 
 #include "src/backend/cpu/backendCPU.hpp"
+#include "src/backend/cpu/backendCPUpool.hpp"
 
+#include <algorithm>
 #include <cstring>
 
-#include <fftw3.h>
-
 template <typename Tdata>
 Tdata * cpu_impl<Tdata>::memory::allocate(unsigned int elements) {
 
-    return (Tdata*) fftw_malloc(sizeof(Tdata) * elements);
+    // 64-byte aligned, as FFTW requires for its SIMD code paths
+    return static_cast<Tdata*>(cpu::details::MemoryPool::instance().allocate(sizeof(Tdata) * elements));
 }
 
 template <typename Tdata>
 void cpu_impl<Tdata>::memory::free(Tdata *data) {
 
-    fftw_free(data);
+    cpu::details::MemoryPool::instance().release(data);
 }
 
 template <typename Tdata>
@@ -69,4 +70,51 @@ void cpu_impl<Tdata>::memory::fill(Tdata * __restrict__ data, unsigned int size,
 
     for (unsigned int i = 0; i < size; ++i)
         data[i] = value;
-}
\ No newline at end of file
+}
+
+template <typename Tdata>
+void cpu_impl<Tdata>::memory::copyStrided(Tdata       * __restrict__ dst         ,
+                                          long int                   dstRowStride,
+                                          long int                   dstColStride,
+                                          const Tdata * __restrict__ src         ,
+                                          long int                   srcRowStride,
+                                          long int                   srcColStride,
+                                          unsigned int               rows        ,
+                                          unsigned int               cols        ) {
+
+    if (dstColStride == 1 && srcColStride == 1) {
+        for (unsigned int i = 0; i < rows; ++i)
+            std::memcpy(dst + i * dstRowStride, src + i * srcRowStride,
+                        cols * sizeof(Tdata));
+        return;
+    }
+
+    // tiles keep both the source and destination lines in cache when one of
+    // the two walks against its storage order (e.g. transposed views)
+    const unsigned int tile = 32;
+    for (unsigned int i = 0; i < rows; i += tile) {
+        for (unsigned int j = 0; j < cols; j += tile) {
+            for (unsigned int ii = i; ii < std::min(rows, i + tile); ++ii) {
+                Tdata * __restrict out = dst + ii * dstRowStride;
+                const Tdata * __restrict in = src + ii * srcRowStride;
+                for (unsigned int jj = j; jj < std::min(cols, j + tile); ++jj)
+                    out[jj * dstColStride] = in[jj * srcColStride];
+            }
+        }
+    }
+}
+
+template <typename Tdata>
+void cpu_impl<Tdata>::memory::fillStrided(Tdata * __restrict__ data     ,
+                                          long int             rowStride,
+                                          long int             colStride,
+                                          unsigned int         rows     ,
+                                          unsigned int         cols     ,
+                                          Tdata                value    ) {
+
+    for (unsigned int i = 0; i < rows; ++i) {
+        Tdata * __restrict row = data + i * rowStride;
+        for (unsigned int j = 0; j < cols; ++j)
+            row[j * colStride] = value;
+    }
+}
@@ -28,6 +28,7 @@
  */
 
 #include "src/backend/cpu/backendCPU.hpp"
+#include "src/backend/cpu/backendCPUsimd.hpp"
 #include "src/utils/utils.hpp"
 
 #include <cmath>
@@ -119,12 +120,42 @@ void cpu_impl<Tdata>::op::mirror(Tdata * __restrict__ inData ,
         outData[i] = inData[i] * Tdata(std::pow(-1.0, i));
 }
 
+// t and t2 are magnitudes; complex data go through the vector kernels
+template <typename Tdata>
+static void shrinkData(Tdata * __restrict__ data, unsigned int size,
+                       ThresholdRule rule, Tdata t, Tdata t2) {
+
+    for (unsigned int i = 0; i < size; ++i)
+        data[i] *= cpu::details::shrinkGain(data[i] * data[i], rule, t, t2);
+}
+
+template <typename T>
+static void shrinkData(std::complex<T> * __restrict__ data, unsigned int size,
+                       ThresholdRule rule, std::complex<T> t, std::complex<T> t2) {
+
+    cpu::details::shrinkKernel<T>(rule, cpu::details::simdLevel())(data, size, std::real(t), std::real(t2));
+}
+
 template <typename Tdata>
 void cpu_impl<Tdata>::op::applyThreshold(Tdata        * __restrict__ data     ,
                                          Tdata                       threshold,
                                          unsigned int                size     ) {
 
-    for (unsigned int i = 0; i < size; ++i)
-        if (std::abs(data[i]) < std::abs(threshold))
-            data[i] = 0 ;
+    shrink(data, size, THRESHOLD_HARD, threshold, threshold);
+}
+
+template <typename Tdata>
+void cpu_impl<Tdata>::op::shrink(Tdata         * __restrict__ data      ,
+                                 unsigned int                 size      ,
+                                 ThresholdRule                rule      ,
+                                 Tdata                        threshold ,
+                                 Tdata                        threshold2) {
+
+    // a zero threshold keeps every coefficient
+    if (std::abs(threshold) == 0)
+        return;
+
+    assert(rule != THRESHOLD_FIRM || std::abs(threshold2) > std::abs(threshold));
+
+    shrinkData(data, size, rule, Tdata(std::abs(threshold)), Tdata(std::abs(threshold2)));
 }
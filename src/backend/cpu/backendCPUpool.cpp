@@ -0,0 +1,161 @@
+/*
+ * @file backendCPUpool.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "src/backend/cpu/backendCPUpool.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace cpu {
+
+    namespace details {
+
+        // each block starts with a header holding its size class, so that
+        // release needs only the pointer; classes start at 1 (0 = unpooled)
+        static constexpr size_t s_header = MemoryPool::s_alignment;
+
+        // lowest power of two of the pooled sizes and number of classes
+        static constexpr unsigned int s_minLog2 = 16;
+        static constexpr unsigned int s_classesPerOctave = 4;
+        static constexpr unsigned int s_octaves = 48 - s_minLog2;
+        static_assert(MemoryPool::s_minPooled == size_t(1) << s_minLog2, "pool bounds");
+
+        MemoryPool& MemoryPool::instance()
+        {
+            // never destroyed: matrices may be freed during static destruction
+            static MemoryPool * pool = new MemoryPool();
+            return *pool;
+        }
+
+        MemoryPool::MemoryPool()
+        : m_free(1 + (s_octaves + 1) * s_classesPerOctave),
+          m_cached(0),
+          m_capacity(size_t(1) << 30)
+        { }
+
+        // class k >= 1 holds 2^(s_minLog2 + (k-1) / 4) * (4 + (k-1) % 4) / 4
+        // bytes: 64K, 80K, 96K, 112K, 128K, 160K, ...
+        unsigned int MemoryPool::sizeClass(size_t bytes)
+        {
+            if (bytes < s_minPooled)
+                return 0;
+
+            unsigned int log2 = 0;
+            while ((size_t(2) << log2) <= bytes)
+                ++log2;
+            size_t base = size_t(1) << log2;
+            size_t step = base / s_classesPerOctave;
+            unsigned int quarter = (bytes - base + step - 1) / step;
+            return 1 + (log2 - s_minLog2) * s_classesPerOctave + quarter;
+        }
+
+        size_t MemoryPool::classBytes(unsigned int sizeClass)
+        {
+            unsigned int k = sizeClass - 1;
+            size_t base = size_t(1) << (s_minLog2 + k / s_classesPerOctave);
+            return base / s_classesPerOctave * (s_classesPerOctave + k % s_classesPerOctave);
+        }
+
+        void * MemoryPool::allocate(size_t bytes)
+        {
+            unsigned int cls = sizeClass(bytes);
+            if (cls >= m_free.size())
+                cls = 0;
+
+            if (cls != 0) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                std::vector<void*>& blocks = m_free[cls];
+                if (!blocks.empty()) {
+                    void * block = blocks.back();
+                    blocks.pop_back();
+                    m_cached -= classBytes(cls);
+                    return static_cast<char*>(block) + s_header;
+                }
+            }
+
+            size_t size = cls != 0 ? classBytes(cls) : bytes;
+            // aligned_alloc needs a multiple of the alignment
+            size = (size + s_header + s_alignment - 1) / s_alignment * s_alignment;
+            void * block = std::aligned_alloc(s_alignment, size);
+            if (block == nullptr)
+                throw std::bad_alloc();
+            *static_cast<unsigned int*>(block) = cls;
+            return static_cast<char*>(block) + s_header;
+        }
+
+        void MemoryPool::release(void * ptr)
+        {
+            if (ptr == nullptr)
+                return;
+
+            void * block = static_cast<char*>(ptr) - s_header;
+            unsigned int cls = *static_cast<unsigned int*>(block);
+
+            if (cls != 0) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_cached + classBytes(cls) <= m_capacity) {
+                    m_free[cls].push_back(block);
+                    m_cached += classBytes(cls);
+                    return;
+                }
+            }
+            std::free(block);
+        }
+
+        void MemoryPool::setCapacity(size_t bytes)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_capacity = bytes;
+                if (m_cached <= m_capacity)
+                    return;
+            }
+            trim();
+        }
+
+        void MemoryPool::trim()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (std::vector<void*>& blocks : m_free) {
+                for (void * block : blocks)
+                    std::free(block);
+                blocks.clear();
+            }
+            m_cached = 0;
+        }
+
+        size_t MemoryPool::cachedBytes() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_cached;
+        }
+
+    }
+
+}
@@ -0,0 +1,78 @@
+/*
+ * @file backendCPUpool.hpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BACKENDCPUPOOL_HPP_
+#define BACKENDCPUPOOL_HPP_
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace cpu {
+
+    namespace details {
+
+        // Process-wide pool behind cpu_impl<T>::memory: blocks of at least
+        // s_minPooled bytes are rounded up to a size class (4 per power of
+        // two) and recycled on free instead of going back to the system.
+        // Every block is 64-byte aligned
+        class MemoryPool {
+        public:
+            static MemoryPool& instance();
+
+            void * allocate(size_t bytes);
+            void release(void * ptr);
+
+            // upper bound of the bytes kept for reuse (0 disables caching)
+            void setCapacity(size_t bytes);
+            // give every cached block back to the system
+            void trim();
+            size_t cachedBytes() const;
+
+            static constexpr size_t s_alignment = 64;
+            static constexpr size_t s_minPooled = 64 * 1024;
+        private:
+            MemoryPool();
+            MemoryPool(const MemoryPool&) = delete;
+            MemoryPool& operator=(const MemoryPool&) = delete;
+
+            static unsigned int sizeClass(size_t bytes);
+            static size_t classBytes(unsigned int sizeClass);
+
+            mutable std::mutex m_mutex;
+            std::vector<std::vector<void*>> m_free;
+            size_t m_cached;
+            size_t m_capacity;
+        };
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,417 @@
+/*
+ * @file backendCPUsimd.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "src/backend/cpu/backendCPUsimd.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NOISY_SIMD_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define NOISY_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace cpu {
+
+    namespace details {
+
+        // scalar loops, used when no vector kernel is available
+
+        template <typename T>
+        static void corrScalar(const std::complex<T> * __restrict__ in1,
+                               const std::complex<T> * __restrict__ in2,
+                               std::complex<T> * __restrict__ out,
+                               unsigned int size) {
+
+            for (unsigned int i = 0; i < size; ++i)
+                out[i] = in1[i] * std::conj(in2[i]);
+        }
+
+        template <typename T>
+        static void convScalar(const std::complex<T> * __restrict__ in1,
+                               const std::complex<T> * __restrict__ in2,
+                               std::complex<T> * __restrict__ out,
+                               unsigned int size) {
+
+            for (unsigned int i = 0; i < size; ++i)
+                out[i] = in1[i] * in2[i];
+        }
+
+        template <typename T, ThresholdRule rule>
+        static void shrinkScalar(std::complex<T> * __restrict__ data,
+                                 unsigned int size, T t, T t2) {
+
+            for (unsigned int i = 0; i < size; ++i)
+                data[i] *= shrinkGain(std::norm(data[i]), rule, t, t2);
+        }
+
+#ifdef NOISY_SIMD_X86
+
+        // With a = (ar, ai) and b = (br, bi) per pair, a_sw = (ai, ar),
+        // b_re = (br, br) and b_im = (bi, bi):
+        //   a * b       = fmaddsub(a, b_re, a_sw * b_im)
+        //   a * conj(b) = fmsubadd(a, b_re, a_sw * b_im)
+
+        template <bool conjugate>
+        __attribute__((target("avx2,fma"), always_inline))
+        static inline void blockAVX2(const float * a, const float * b, float * c) {
+
+            __m256 va   = _mm256_loadu_ps(a);
+            __m256 vb   = _mm256_loadu_ps(b);
+            __m256 bRe  = _mm256_moveldup_ps(vb);
+            __m256 bIm  = _mm256_movehdup_ps(vb);
+            __m256 aSw  = _mm256_permute_ps(va, 0xB1);
+            __m256 prod = _mm256_mul_ps(aSw, bIm);
+            _mm256_storeu_ps(c, conjugate ? _mm256_fmsubadd_ps(va, bRe, prod)
+                                          : _mm256_fmaddsub_ps(va, bRe, prod));
+        }
+
+        template <bool conjugate>
+        __attribute__((target("avx2,fma"), always_inline))
+        static inline void blockAVX2(const double * a, const double * b, double * c) {
+
+            __m256d va   = _mm256_loadu_pd(a);
+            __m256d vb   = _mm256_loadu_pd(b);
+            __m256d bRe  = _mm256_movedup_pd(vb);
+            __m256d bIm  = _mm256_permute_pd(vb, 0xF);
+            __m256d aSw  = _mm256_permute_pd(va, 0x5);
+            __m256d prod = _mm256_mul_pd(aSw, bIm);
+            _mm256_storeu_pd(c, conjugate ? _mm256_fmsubadd_pd(va, bRe, prod)
+                                          : _mm256_fmaddsub_pd(va, bRe, prod));
+        }
+
+        // the swaps and duplications are shuffles: the dedicated AVX-512
+        // intrinsics (moveldup, permute, ...) raise -Wmaybe-uninitialized
+        // inside the GCC 12 headers
+        template <bool conjugate>
+        __attribute__((target("avx512f"), always_inline))
+        static inline void blockAVX512(const float * a, const float * b, float * c) {
+
+            __m512 va   = _mm512_loadu_ps(a);
+            __m512 vb   = _mm512_loadu_ps(b);
+            __m512 bRe  = _mm512_shuffle_ps(vb, vb, 0xA0);
+            __m512 bIm  = _mm512_shuffle_ps(vb, vb, 0xF5);
+            __m512 aSw  = _mm512_shuffle_ps(va, va, 0xB1);
+            __m512 prod = _mm512_mul_ps(aSw, bIm);
+            _mm512_storeu_ps(c, conjugate ? _mm512_fmsubadd_ps(va, bRe, prod)
+                                          : _mm512_fmaddsub_ps(va, bRe, prod));
+        }
+
+        template <bool conjugate>
+        __attribute__((target("avx512f"), always_inline))
+        static inline void blockAVX512(const double * a, const double * b, double * c) {
+
+            __m512d va   = _mm512_loadu_pd(a);
+            __m512d vb   = _mm512_loadu_pd(b);
+            __m512d bRe  = _mm512_shuffle_pd(vb, vb, 0x00);
+            __m512d bIm  = _mm512_shuffle_pd(vb, vb, 0xFF);
+            __m512d aSw  = _mm512_shuffle_pd(va, va, 0x55);
+            __m512d prod = _mm512_mul_pd(aSw, bIm);
+            _mm512_storeu_pd(c, conjugate ? _mm512_fmsubadd_pd(va, bRe, prod)
+                                          : _mm512_fmaddsub_pd(va, bRe, prod));
+        }
+
+        // The tail goes through a zero-padded block, so every element is
+        // computed with the same instructions whatever its position (the
+        // box kernels start their rows at arbitrary offsets)
+
+        template <typename T, bool conjugate>
+        __attribute__((target("avx2,fma")))
+        static void mulAVX2(const std::complex<T> * __restrict__ in1,
+                            const std::complex<T> * __restrict__ in2,
+                            std::complex<T> * __restrict__ out,
+                            unsigned int size) {
+
+            constexpr unsigned int width = 32 / sizeof(std::complex<T>);
+            const T * a = reinterpret_cast<const T *>(in1);
+            const T * b = reinterpret_cast<const T *>(in2);
+            T * c = reinterpret_cast<T *>(out);
+
+            unsigned int i = 0;
+            for (; i + width <= size; i += width)
+                blockAVX2<conjugate>(a + 2*i, b + 2*i, c + 2*i);
+            if (i < size) {
+                T ta[2*width] = {}, tb[2*width] = {}, tc[2*width];
+                std::memcpy(ta, a + 2*i, 2*(size - i) * sizeof(T));
+                std::memcpy(tb, b + 2*i, 2*(size - i) * sizeof(T));
+                blockAVX2<conjugate>(ta, tb, tc);
+                std::memcpy(c + 2*i, tc, 2*(size - i) * sizeof(T));
+            }
+        }
+
+        template <typename T, bool conjugate>
+        __attribute__((target("avx512f")))
+        static void mulAVX512(const std::complex<T> * __restrict__ in1,
+                              const std::complex<T> * __restrict__ in2,
+                              std::complex<T> * __restrict__ out,
+                              unsigned int size) {
+
+            constexpr unsigned int width = 64 / sizeof(std::complex<T>);
+            const T * a = reinterpret_cast<const T *>(in1);
+            const T * b = reinterpret_cast<const T *>(in2);
+            T * c = reinterpret_cast<T *>(out);
+
+            unsigned int i = 0;
+            for (; i + width <= size; i += width)
+                blockAVX512<conjugate>(a + 2*i, b + 2*i, c + 2*i);
+            if (i < size) {
+                T ta[2*width] = {}, tb[2*width] = {}, tc[2*width];
+                std::memcpy(ta, a + 2*i, 2*(size - i) * sizeof(T));
+                std::memcpy(tb, b + 2*i, 2*(size - i) * sizeof(T));
+                blockAVX512<conjugate>(ta, tb, tc);
+                std::memcpy(c + 2*i, tc, 2*(size - i) * sizeof(T));
+            }
+        }
+
+        // The squared magnitude of each pair is summed into both its lanes,
+        // so the gain multiplies the pair without any shuffle back. The
+        // gains use the same operations as shrinkGain
+
+        __attribute__((target("avx2"), always_inline))
+        static inline __m256 norm2AVX2(__m256 v) {
+            __m256 sq = _mm256_mul_ps(v, v);
+            return _mm256_add_ps(sq, _mm256_permute_ps(sq, 0xB1));
+        }
+
+        __attribute__((target("avx2"), always_inline))
+        static inline __m256d norm2AVX2(__m256d v) {
+            __m256d sq = _mm256_mul_pd(v, v);
+            return _mm256_add_pd(sq, _mm256_permute_pd(sq, 0x5));
+        }
+
+        template <ThresholdRule rule>
+        __attribute__((target("avx2"), always_inline))
+        static inline void shrinkBlockAVX2(float * c, float t, float t2) {
+
+            const __m256 one  = _mm256_set1_ps(1.0f);
+            const __m256 zero = _mm256_setzero_ps();
+            __m256 v  = _mm256_loadu_ps(c);
+            __m256 r2 = norm2AVX2(v);
+            __m256 gain;
+            if (rule == THRESHOLD_HARD) {
+                _mm256_storeu_ps(c, _mm256_and_ps(v, _mm256_cmp_ps(r2, _mm256_set1_ps(t * t), _CMP_GE_OQ)));
+                return;
+            } else if (rule == THRESHOLD_SOFT) {
+                gain = _mm256_sub_ps(one, _mm256_div_ps(_mm256_set1_ps(t), _mm256_sqrt_ps(r2)));
+            } else if (rule == THRESHOLD_GARROTE) {
+                gain = _mm256_sub_ps(one, _mm256_div_ps(_mm256_set1_ps(t * t), r2));
+            } else {
+                gain = _mm256_sub_ps(one, _mm256_div_ps(_mm256_set1_ps(t), _mm256_sqrt_ps(r2)));
+                gain = _mm256_min_ps(_mm256_mul_ps(_mm256_set1_ps(t2 / (t2 - t)), gain), one);
+            }
+            _mm256_storeu_ps(c, _mm256_mul_ps(v, _mm256_max_ps(gain, zero)));
+        }
+
+        template <ThresholdRule rule>
+        __attribute__((target("avx2"), always_inline))
+        static inline void shrinkBlockAVX2(double * c, double t, double t2) {
+
+            const __m256d one  = _mm256_set1_pd(1.0);
+            const __m256d zero = _mm256_setzero_pd();
+            __m256d v  = _mm256_loadu_pd(c);
+            __m256d r2 = norm2AVX2(v);
+            __m256d gain;
+            if (rule == THRESHOLD_HARD) {
+                _mm256_storeu_pd(c, _mm256_and_pd(v, _mm256_cmp_pd(r2, _mm256_set1_pd(t * t), _CMP_GE_OQ)));
+                return;
+            } else if (rule == THRESHOLD_SOFT) {
+                gain = _mm256_sub_pd(one, _mm256_div_pd(_mm256_set1_pd(t), _mm256_sqrt_pd(r2)));
+            } else if (rule == THRESHOLD_GARROTE) {
+                gain = _mm256_sub_pd(one, _mm256_div_pd(_mm256_set1_pd(t * t), r2));
+            } else {
+                gain = _mm256_sub_pd(one, _mm256_div_pd(_mm256_set1_pd(t), _mm256_sqrt_pd(r2)));
+                gain = _mm256_min_pd(_mm256_mul_pd(_mm256_set1_pd(t2 / (t2 - t)), gain), one);
+            }
+            _mm256_storeu_pd(c, _mm256_mul_pd(v, _mm256_max_pd(gain, zero)));
+        }
+
+        template <typename T, ThresholdRule rule>
+        __attribute__((target("avx2")))
+        static void shrinkAVX2(std::complex<T> * __restrict__ data,
+                               unsigned int size, T t, T t2) {
+
+            constexpr unsigned int width = 32 / sizeof(std::complex<T>);
+            T * c = reinterpret_cast<T *>(data);
+
+            unsigned int i = 0;
+            for (; i + width <= size; i += width)
+                shrinkBlockAVX2<rule>(c + 2*i, t, t2);
+            if (i < size) {
+                T tc[2*width] = {};
+                std::memcpy(tc, c + 2*i, 2*(size - i) * sizeof(T));
+                shrinkBlockAVX2<rule>(tc, t, t2);
+                std::memcpy(c + 2*i, tc, 2*(size - i) * sizeof(T));
+            }
+        }
+
+#endif
+
+#ifdef NOISY_SIMD_NEON
+
+        // vld2 splits the pairs into a real and an imaginary vector
+
+        template <bool conjugate>
+        static inline void blockNEON(const float * a, const float * b, float * c) {
+
+            float32x4x2_t va = vld2q_f32(a);
+            float32x4x2_t vb = vld2q_f32(b);
+            float32x4x2_t vc;
+            if (conjugate) {
+                vc.val[0] = vfmaq_f32(vmulq_f32(va.val[0], vb.val[0]), va.val[1], vb.val[1]);
+                vc.val[1] = vfmsq_f32(vmulq_f32(va.val[1], vb.val[0]), va.val[0], vb.val[1]);
+            } else {
+                vc.val[0] = vfmsq_f32(vmulq_f32(va.val[0], vb.val[0]), va.val[1], vb.val[1]);
+                vc.val[1] = vfmaq_f32(vmulq_f32(va.val[1], vb.val[0]), va.val[0], vb.val[1]);
+            }
+            vst2q_f32(c, vc);
+        }
+
+        template <bool conjugate>
+        static inline void blockNEON(const double * a, const double * b, double * c) {
+
+            float64x2x2_t va = vld2q_f64(a);
+            float64x2x2_t vb = vld2q_f64(b);
+            float64x2x2_t vc;
+            if (conjugate) {
+                vc.val[0] = vfmaq_f64(vmulq_f64(va.val[0], vb.val[0]), va.val[1], vb.val[1]);
+                vc.val[1] = vfmsq_f64(vmulq_f64(va.val[1], vb.val[0]), va.val[0], vb.val[1]);
+            } else {
+                vc.val[0] = vfmsq_f64(vmulq_f64(va.val[0], vb.val[0]), va.val[1], vb.val[1]);
+                vc.val[1] = vfmaq_f64(vmulq_f64(va.val[1], vb.val[0]), va.val[0], vb.val[1]);
+            }
+            vst2q_f64(c, vc);
+        }
+
+        template <typename T, bool conjugate>
+        static void mulNEON(const std::complex<T> * __restrict__ in1,
+                            const std::complex<T> * __restrict__ in2,
+                            std::complex<T> * __restrict__ out,
+                            unsigned int size) {
+
+            constexpr unsigned int width = 32 / sizeof(std::complex<T>);
+            const T * a = reinterpret_cast<const T *>(in1);
+            const T * b = reinterpret_cast<const T *>(in2);
+            T * c = reinterpret_cast<T *>(out);
+
+            unsigned int i = 0;
+            for (; i + width <= size; i += width)
+                blockNEON<conjugate>(a + 2*i, b + 2*i, c + 2*i);
+            if (i < size) {
+                T ta[2*width] = {}, tb[2*width] = {}, tc[2*width];
+                std::memcpy(ta, a + 2*i, 2*(size - i) * sizeof(T));
+                std::memcpy(tb, b + 2*i, 2*(size - i) * sizeof(T));
+                blockNEON<conjugate>(ta, tb, tc);
+                std::memcpy(c + 2*i, tc, 2*(size - i) * sizeof(T));
+            }
+        }
+
+#endif
+
+        SIMDLevel simdLevel() {
+
+            static const SIMDLevel level = []() {
+#if defined(NOISY_SIMD_X86)
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx512f"))
+                    return SIMD_AVX512;
+                if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                    return SIMD_AVX2;
+                return SIMD_SCALAR;
+#elif defined(NOISY_SIMD_NEON)
+                return SIMD_NEON;
+#else
+                return SIMD_SCALAR;
+#endif
+            }();
+            return level;
+        }
+
+        template <typename T>
+        complex_kernel<T> corrKernel(SIMDLevel level) {
+
+            switch (level) {
+#if defined(NOISY_SIMD_X86)
+            case SIMD_AVX512: return mulAVX512<T, true>;
+            case SIMD_AVX2:   return mulAVX2<T, true>;
+#elif defined(NOISY_SIMD_NEON)
+            case SIMD_NEON:   return mulNEON<T, true>;
+#endif
+            default:          return corrScalar<T>;
+            }
+        }
+
+        template <typename T>
+        complex_kernel<T> convKernel(SIMDLevel level) {
+
+            switch (level) {
+#if defined(NOISY_SIMD_X86)
+            case SIMD_AVX512: return mulAVX512<T, false>;
+            case SIMD_AVX2:   return mulAVX2<T, false>;
+#elif defined(NOISY_SIMD_NEON)
+            case SIMD_NEON:   return mulNEON<T, false>;
+#endif
+            default:          return convScalar<T>;
+            }
+        }
+
+        // AVX-512 CPUs run the AVX2 kernel too: the shrinkage is already
+        // bound by memory bandwidth
+        template <typename T>
+        shrink_kernel<T> shrinkKernel(ThresholdRule rule, SIMDLevel level) {
+
+#if defined(NOISY_SIMD_X86)
+            if (level == SIMD_AVX2 || level == SIMD_AVX512) {
+                switch (rule) {
+                case THRESHOLD_HARD:    return shrinkAVX2<T, THRESHOLD_HARD>;
+                case THRESHOLD_SOFT:    return shrinkAVX2<T, THRESHOLD_SOFT>;
+                case THRESHOLD_GARROTE: return shrinkAVX2<T, THRESHOLD_GARROTE>;
+                default:                return shrinkAVX2<T, THRESHOLD_FIRM>;
+                }
+            }
+#endif
+            switch (rule) {
+            case THRESHOLD_HARD:    return shrinkScalar<T, THRESHOLD_HARD>;
+            case THRESHOLD_SOFT:    return shrinkScalar<T, THRESHOLD_SOFT>;
+            case THRESHOLD_GARROTE: return shrinkScalar<T, THRESHOLD_GARROTE>;
+            default:                return shrinkScalar<T, THRESHOLD_FIRM>;
+            }
+        }
+
+        template complex_kernel<float>  corrKernel<float>(SIMDLevel);
+        template complex_kernel<double> corrKernel<double>(SIMDLevel);
+        template complex_kernel<float>  convKernel<float>(SIMDLevel);
+        template complex_kernel<double> convKernel<double>(SIMDLevel);
+        template shrink_kernel<float>   shrinkKernel<float>(ThresholdRule, SIMDLevel);
+        template shrink_kernel<double>  shrinkKernel<double>(ThresholdRule, SIMDLevel);
+
+    }
+
+}
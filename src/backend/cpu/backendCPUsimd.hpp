@@ -0,0 +1,94 @@
+/*
+ * @file backendCPUsimd.hpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BACKENDCPUSIMD_HPP_
+#define BACKENDCPUSIMD_HPP_
+
+#include <complex>
+#include <cmath>
+
+#include "src/transform/ThresholdParams.hpp"
+
+namespace cpu {
+
+    namespace details {
+
+        // instruction sets with an explicit kernel, in increasing order
+        enum SIMDLevel { SIMD_SCALAR, SIMD_NEON, SIMD_AVX2, SIMD_AVX512 };
+
+        // best level supported by both the build and the running CPU
+        // (detected once)
+        SIMDLevel simdLevel();
+
+        // out[i] = in1[i] * conj(in2[i]) (corr) or in1[i] * in2[i] (conv)
+        // on interleaved real/imaginary pairs; in1, in2 and out must not
+        // overlap. Unlike std::complex the kernels do not recover Inf/NaN
+        // products
+        template <typename T>
+        using complex_kernel = void (*)(const std::complex<T> * __restrict__ in1,
+                                        const std::complex<T> * __restrict__ in2,
+                                        std::complex<T> * __restrict__ out,
+                                        unsigned int size);
+
+        // kernels for the given level; levels not compiled in fall back to
+        // the scalar loop
+        template <typename T>
+        complex_kernel<T> corrKernel(SIMDLevel level);
+        template <typename T>
+        complex_kernel<T> convKernel(SIMDLevel level);
+
+        // gain of a coefficient of squared magnitude r2 (see ThresholdRule),
+        // with threshold t > 0 and, for firm shrinkage, t2 > t
+        template <typename T>
+        inline T shrinkGain(T r2, ThresholdRule rule, T t, T t2) {
+
+            T gain;
+            switch (rule) {
+            case THRESHOLD_HARD:    return r2 >= t * t ? T(1) : T(0);
+            case THRESHOLD_SOFT:    gain = T(1) - t / std::sqrt(r2); break;
+            case THRESHOLD_GARROTE: gain = T(1) - t * t / r2; break;
+            default:                gain = t2 / (t2 - t) * (T(1) - t / std::sqrt(r2));
+                                    gain = gain < T(1) ? gain : T(1); break;
+            }
+            return gain > T(0) ? gain : T(0);
+        }
+
+        // data[i] *= gain(|data[i]|^2) in place, t > 0
+        template <typename T>
+        using shrink_kernel = void (*)(std::complex<T> * __restrict__ data,
+                                       unsigned int size, T t, T t2);
+
+        template <typename T>
+        shrink_kernel<T> shrinkKernel(ThresholdRule rule, SIMDLevel level);
+
+    }
+
+}
+
+#endif
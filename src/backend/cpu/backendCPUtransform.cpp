@@ -28,10 +28,12 @@
  */
 
 #include "src/backend/cpu/backendCPU.hpp"
+#include "src/backend/cpu/backendCPUgemm.hpp"
 
 #include <cmath>
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 
 template <typename Tdata>
 void cpu_impl<Tdata>::transform::downsample(Tdata * __restrict__ inMat,
@@ -168,6 +170,97 @@ void cpu_impl<Tdata>::transform::pad(Tdata * __restrict__ in   ,
     }
 }
 
+template <typename Tdata>
+void cpu_impl<Tdata>::transform::crop(Tdata * __restrict__ in   ,
+                                      Tdata * __restrict__ out  ,
+                                      unsigned int         row  ,
+                                      unsigned int         col  ,
+                                      unsigned int         nRows,
+                                      unsigned int         nCols,
+                                      unsigned int         mRows,
+                                      unsigned int         mCols) {
+
+    assert(row + nRows <= mRows);
+    assert(col + nCols <= mCols);
+
+    for (unsigned int i = 0; i < nRows; ++i) {
+
+        const Tdata * __restrict inRow  = in  + (row + i) * mCols + col ;
+        Tdata * __restrict outRow = out + i * nCols;
+        std::memcpy(outRow, inRow, nCols * sizeof(Tdata));
+    }
+}
+
+// inverse of crop: everything outside the box is set to zero
+template <typename Tdata>
+void cpu_impl<Tdata>::transform::embed(Tdata * __restrict__ in   ,
+                                       Tdata * __restrict__ out  ,
+                                       unsigned int         row  ,
+                                       unsigned int         col  ,
+                                       unsigned int         nRows,
+                                       unsigned int         nCols,
+                                       unsigned int         mRows,
+                                       unsigned int         mCols) {
+
+    assert(row + nRows <= mRows);
+    assert(col + nCols <= mCols);
+
+    for (unsigned int i = 0; i < mRows; ++i) {
+        Tdata * __restrict outRow  = out  + i * mCols ;
+        for (unsigned int j = 0; j < mCols; ++j) {
+            outRow[j] = static_cast<Tdata>(0);
+        }
+    }
+
+    for (unsigned int i = 0; i < nRows; ++i) {
+
+        const Tdata * __restrict inRow  = in  + i * nCols ;
+        Tdata * __restrict outRow = out + (row + i) * mCols + col;
+        std::memcpy(outRow, inRow, nCols * sizeof(Tdata));
+    }
+}
+
+// bounding box of the entries larger than tolerance times the maximum
+// magnitude; box = {row, col, rows, cols}, at least 1 x 1
+template <typename Tdata>
+void cpu_impl<Tdata>::transform::support(Tdata * __restrict__ in       ,
+                                         Tdata                tolerance,
+                                         unsigned int         mRows    ,
+                                         unsigned int         mCols    ,
+                                         unsigned int         box[4]   ) {
+
+    using real_type = decltype(std::abs(tolerance));
+
+    real_type maxAbs = 0;
+    for (unsigned int i = 0; i < mRows * mCols; ++i)
+        maxAbs = std::max(maxAbs, real_type(std::abs(in[i])));
+    real_type threshold = std::abs(tolerance) * maxAbs;
+
+    unsigned int rowMin = mRows, rowMax = 0;
+    unsigned int colMin = mCols, colMax = 0;
+    for (unsigned int i = 0; i < mRows; ++i) {
+        const Tdata * __restrict inRow = in + i * mCols;
+        for (unsigned int j = 0; j < mCols; ++j) {
+            if (std::abs(inRow[j]) > threshold) {
+                rowMin = std::min(rowMin, i);
+                rowMax = std::max(rowMax, i);
+                colMin = std::min(colMin, j);
+                colMax = std::max(colMax, j);
+            }
+        }
+    }
+
+    if (rowMin > rowMax) {
+        rowMin = rowMax = 0;
+        colMin = colMax = 0;
+    }
+
+    box[0] = rowMin;
+    box[1] = colMin;
+    box[2] = rowMax - rowMin + 1;
+    box[3] = colMax - colMin + 1;
+}
+
 template <typename Tdata>
 void cpu_impl<Tdata>::transform::dshear(Tdata * __restrict__ inData ,
                                         Tdata * __restrict__ outData,
@@ -182,7 +275,7 @@ void cpu_impl<Tdata>::transform::dshear(Tdata * __restrict__ inData ,
 
          for (unsigned int j = 0; j < mCols; ++j) {
 
-            long int shift = -k*(mCols / 2 - j);
+            long int shift = -k*((long int)(mCols / 2) - (long int)j);
             if (shift < 0) {
 
                 for (unsigned int i = 0; i < mRows+shift; ++i )
@@ -203,7 +296,7 @@ void cpu_impl<Tdata>::transform::dshear(Tdata * __restrict__ inData ,
 
         for (unsigned int  i = 0; i < mRows; ++i) {
 
-            long int shift = -k*(mRows / 2 - i);
+            long int shift = -k*((long int)(mRows / 2) - (long int)i);
             const Tdata * __restrict in  = inData  + i * mCols ;
             Tdata * __restrict out = outData + i * mCols ;
             if (shift < 0) {
@@ -253,6 +346,7 @@ void cpu_impl<Tdata>::transform::normL2(Tdata * __restrict__ inData ,
         *outData += std::abs(inData[i]) * std::abs(inData[i]);
 }
 
+// outData = inDataL * inDataR (overwritten)
 template <typename Tdata>
 void cpu_impl<Tdata>::transform::matMul(Tdata * __restrict__ inDataL,
                                         Tdata * __restrict__ inDataR,
@@ -260,14 +354,9 @@ void cpu_impl<Tdata>::transform::matMul(Tdata * __restrict__ inDataL,
                                         unsigned int inRowsL,
                                         unsigned int inColsL,
                                         unsigned int inRowsR,
-                                        unsigned int inColsR) {
+                                        unsigned int inColsR,
+                                        ThreadPool * pool) {
 
-    for (unsigned int i = 0; i < inRowsL; ++i) {
-        for (unsigned int j = 0; j < inColsR; ++j) {
-            for (unsigned int k = 0; k < inColsL; ++k ) {
-                outData[i * inColsR + j] += inDataL[i * inColsL + k] *
-                                            inDataR[k * inColsR + j];
-            }
-        }
-    }
+    assert(inColsL == inRowsR);
+    cpu::details::gemm(inDataL, inDataR, outData, inRowsL, inColsL, inColsR, pool);
 }
@@ -54,7 +54,7 @@ namespace cuda {
         };
 
         template<typename T, typename ComplexT, cufftType type>
-        fourier_impl<T, ComplexT, type>::fourier_impl(unsigned int rows, unsigned int cols)
+        fourier_impl<T, ComplexT, type>::fourier_impl(unsigned int rows, unsigned int cols, FFTRigor, unsigned int)
         : m_rows(rows),
           m_cols(cols)
         {
@@ -32,6 +32,10 @@
 
 #include <cufft.h>
 #include <thrust/complex.h>
+#include <memory>
+#include <string>
+
+#include "src/fourier/FourierParams.hpp"
 
 namespace cuda {
 
@@ -44,8 +48,20 @@ namespace cuda {
             unsigned int m_cols;
             cufftHandle m_plan ;
         public:
-            fourier_impl(unsigned int rows, unsigned int cols);
+            // cuFFT has no planner rigor, wisdom nor host threads
+            fourier_impl(unsigned int rows, unsigned int cols,
+                         FFTRigor rigor = FFT_ESTIMATE,
+                         unsigned int nThreads = 1);
             ~fourier_impl();
+            // cuFFT plans are not cached
+            static std::shared_ptr<fourier_impl> instance(unsigned int rows, unsigned int cols,
+                                                          FFTRigor rigor = FFT_ESTIMATE,
+                                                          unsigned int nThreads = 1) {
+                return std::make_shared<fourier_impl>(rows, cols, rigor, nThreads);
+            }
+            static void clearCache() {}
+            static bool importWisdom(const std::string&) { return false; }
+            static bool exportWisdom(const std::string&) { return false; }
             void fft(thrust::complex<T> * data);
             void ifft(thrust::complex<T> * data);
             void fftshift(thrust::complex<T> * data);
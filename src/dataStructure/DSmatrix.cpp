@@ -27,6 +27,8 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <cassert>
+
 #include "src/dataStructure/dataStruct.hpp"
 
 #include "src/backend/cpu/backendCPU.hpp"
@@ -86,6 +88,19 @@ DSmatrix<Tdata, backend>::DSmatrix(const DSmatrix& inMat)
     backend<Tdata>::memory::copy(mData, inMat.mData, mRows*mCols);
 }
 
+template <typename Tdata, template <class> class backend>
+DSmatrix<Tdata, backend>::DSmatrix(DSmatrix&& inMat) noexcept
+: mRows(inMat.mRows),
+  mCols(inMat.mCols),
+  mNeedAlloc(inMat.mNeedAlloc),
+  mData(inMat.mData)
+{
+    inMat.mRows = 0;
+    inMat.mCols = 0;
+    inMat.mNeedAlloc = false;
+    inMat.mData = nullptr;
+}
+
 // destructor
 template <typename Tdata, template <class> class backend>
 DSmatrix<Tdata, backend>::~DSmatrix()
@@ -110,6 +125,46 @@ Tdata  DSmatrix<Tdata,backend>::operator()(unsigned int i, unsigned int j) const
     return mData[i * mCols + j];
 }
 
+template <typename Tdata, template <class> class backend>
+DSmatrix<Tdata, backend>& DSmatrix<Tdata, backend>::operator=(const DSmatrix<Tdata, backend>& B) {
+
+    if (this == &B)
+        return *this;
+
+    // reuse the buffer when the size matches
+    if (mData == nullptr || mRows * mCols != B.mRows * B.mCols) {
+        if (mNeedAlloc)
+            backend<Tdata>::memory::free(mData);
+        mData = backend<Tdata>::memory::allocate(B.mRows * B.mCols);
+        mNeedAlloc = true;
+    }
+    mRows = B.mRows;
+    mCols = B.mCols;
+    backend<Tdata>::memory::copy(mData, B.mData, mRows*mCols);
+
+    return *this;
+}
+
+template <typename Tdata, template <class> class backend>
+DSmatrix<Tdata, backend>& DSmatrix<Tdata, backend>::operator=(DSmatrix<Tdata, backend>&& B) noexcept {
+
+    if (this == &B)
+        return *this;
+
+    if (mNeedAlloc)
+        backend<Tdata>::memory::free(mData);
+    mRows = B.mRows;
+    mCols = B.mCols;
+    mNeedAlloc = B.mNeedAlloc;
+    mData = B.mData;
+    B.mRows = 0;
+    B.mCols = 0;
+    B.mNeedAlloc = false;
+    B.mData = nullptr;
+
+    return *this;
+}
+
 template <typename Tdata, template <class> class backend>
 DSmatrix<Tdata, backend>& DSmatrix<Tdata, backend>::operator+=(const DSmatrix<Tdata, backend>& B) {
 
@@ -178,6 +233,18 @@ bool DSmatrix<Tdata, backend>::is_empty() const
     return (mRows == 0 && mCols == 0 && mData == nullptr);
 }
 
+template <typename Tdata, template <class> class backend>
+DSmatrixView<Tdata, backend> DSmatrix<Tdata, backend>::view() const
+{
+    return DSmatrixView<Tdata, backend>(*this);
+}
+
+template <typename Tdata, template <class> class backend>
+DSmatrixView<Tdata, backend> DSmatrix<Tdata, backend>::view(const t_box& box) const
+{
+    return DSmatrixView<Tdata, backend>(*this).subview(box);
+}
+
 // in place operations
 template <typename Tdata, template <class> class backend>
 void DSmatrix<Tdata, backend>::normalize() {
@@ -203,6 +270,119 @@ void DSmatrix<Tdata, backend>::applyThreshold(Tdata value) {
     backend<Tdata>::op::applyThreshold(mData, value, mRows * mCols);
 }
 
+// VIEW
+
+// constructors
+template <typename Tdata, template <class> class backend>
+DSmatrixView<Tdata, backend>::DSmatrixView(Tdata*       base     ,
+                                           unsigned int rows     ,
+                                           unsigned int cols     ,
+                                           long int     rowStride,
+                                           long int     colStride,
+                                           long int     offset   )
+: mBase(base),
+  mRows(rows),
+  mCols(cols),
+  mRowStride(rowStride),
+  mColStride(colStride),
+  mOffset(offset)
+{ }
+
+template <typename Tdata, template <class> class backend>
+DSmatrixView<Tdata, backend>::DSmatrixView(const DSmatrix<Tdata, backend>& mat)
+: mBase(mat.data()),
+  mRows(mat.dims().rows),
+  mCols(mat.dims().cols),
+  mRowStride(mat.dims().cols),
+  mColStride(1),
+  mOffset(0)
+{ }
+
+// operators
+template <typename Tdata, template <class> class backend>
+Tdata& DSmatrixView<Tdata, backend>::operator()(unsigned int i, unsigned int j) const
+{
+    assert(i < mRows && j < mCols);
+    return mBase[mOffset + long(i) * mRowStride + long(j) * mColStride];
+}
+
+// inline info
+template <typename Tdata, template <class> class backend>
+Tdata * DSmatrixView<Tdata, backend>::data() const
+{
+    return mBase + mOffset;
+}
+
+template <typename Tdata, template <class> class backend>
+t_dims DSmatrixView<Tdata, backend>::dims() const
+{
+    return t_dims{.rows = mRows, .cols = mCols};
+}
+
+template <typename Tdata, template <class> class backend>
+unsigned int DSmatrixView<Tdata, backend>::size() const
+{
+    return mRows * mCols;
+}
+
+template <typename Tdata, template <class> class backend>
+long int DSmatrixView<Tdata, backend>::rowStride() const
+{
+    return mRowStride;
+}
+
+template <typename Tdata, template <class> class backend>
+long int DSmatrixView<Tdata, backend>::colStride() const
+{
+    return mColStride;
+}
+
+template <typename Tdata, template <class> class backend>
+long int DSmatrixView<Tdata, backend>::offset() const
+{
+    return mOffset;
+}
+
+template <typename Tdata, template <class> class backend>
+bool DSmatrixView<Tdata, backend>::is_contiguous() const
+{
+    return (mColStride == 1 && (mRows <= 1 || mRowStride == long(mCols)));
+}
+
+// derived views
+template <typename Tdata, template <class> class backend>
+DSmatrixView<Tdata, backend>
+DSmatrixView<Tdata, backend>::subview(const t_box& box) const
+{
+    assert(box.row + box.rows <= mRows);
+    assert(box.col + box.cols <= mCols);
+    return DSmatrixView(mBase, box.rows, box.cols, mRowStride, mColStride,
+                        mOffset + long(box.row) * mRowStride
+                                + long(box.col) * mColStride);
+}
+
+// every rowStep-th row and colStep-th column starting at (row, col)
+template <typename Tdata, template <class> class backend>
+DSmatrixView<Tdata, backend>
+DSmatrixView<Tdata, backend>::subsample(unsigned int rowStep,
+                                        unsigned int colStep,
+                                        unsigned int row    ,
+                                        unsigned int col    ) const
+{
+    assert(rowStep > 0 && colStep > 0);
+    unsigned int rows = row < mRows ? (mRows - row + rowStep - 1) / rowStep : 0;
+    unsigned int cols = col < mCols ? (mCols - col + colStep - 1) / colStep : 0;
+    return DSmatrixView(mBase, rows, cols,
+                        mRowStride * long(rowStep), mColStride * long(colStep),
+                        mOffset + long(row) * mRowStride + long(col) * mColStride);
+}
+
+template <typename Tdata, template <class> class backend>
+DSmatrixView<Tdata, backend> DSmatrixView<Tdata, backend>::transposed() const
+{
+    return DSmatrixView(mBase, mCols, mRows, mColStride, mRowStride, mOffset);
+}
+
 // INSTANTIATION
 
 // CPU
@@ -210,6 +390,10 @@ template class DSmatrix<float, cpu_impl>;
 template class DSmatrix<double, cpu_impl>;
 template class DSmatrix<std::complex<float>, cpu_impl>;
 template class DSmatrix<std::complex<double>, cpu_impl>;
+template class DSmatrixView<float, cpu_impl>;
+template class DSmatrixView<double, cpu_impl>;
+template class DSmatrixView<std::complex<float>, cpu_impl>;
+template class DSmatrixView<std::complex<double>, cpu_impl>;
 
 // CUDA
 #ifdef CUDA
@@ -217,4 +401,8 @@ template class DSmatrix<float, cuda_impl>;
 template class DSmatrix<double, cuda_impl>;
 template class DSmatrix<thrust::complex<float>, cuda_impl>;
 template class DSmatrix<thrust::complex<double>, cuda_impl>;
+template class DSmatrixView<float, cuda_impl>;
+template class DSmatrixView<double, cuda_impl>;
+template class DSmatrixView<thrust::complex<float>, cuda_impl>;
+template class DSmatrixView<thrust::complex<double>, cuda_impl>;
 #endif
@@ -36,6 +36,18 @@ struct t_dims {
 };
 typedef struct t_dims t_dims;
 
+// sub-matrix [row, row + rows) x [col, col + cols)
+struct t_box {
+    unsigned int row;
+    unsigned int col;
+    unsigned int rows;
+    unsigned int cols;
+};
+typedef struct t_box t_box;
+
+template <typename Tdata, template <class> class  backend>
+class DSmatrixView;
+
 template <typename Tdata, template <class> class  backend>
 class DSmatrix
 {
@@ -47,9 +59,13 @@ public:
     DSmatrix(unsigned int rows, unsigned int cols, Tdata value);
     DSmatrix(unsigned int rows, unsigned int cols, Tdata *ptr);
     DSmatrix(const DSmatrix& inMat);
+    // takes over the buffer (and its ownership), leaving inMat empty
+    DSmatrix(DSmatrix&& inMat) noexcept;
     // destructor
     ~DSmatrix();
     // operators
+    DSmatrix<Tdata, backend>& operator=(const DSmatrix<Tdata, backend>& B);
+    DSmatrix<Tdata, backend>& operator=(DSmatrix<Tdata, backend>&& B) noexcept;
     DSmatrix<Tdata, backend>& operator+=(const DSmatrix<Tdata, backend>& B);
     DSmatrix<Tdata, backend>& operator*=(const DSmatrix<Tdata, backend>& B);
     DSmatrix<Tdata, backend>& operator*=(const Tdata b);
@@ -62,6 +78,9 @@ public:
     t_dims dims() const;
     unsigned int size() const;
     bool is_empty() const;
+    // non-owning views on the whole matrix or on a sub-matrix
+    DSmatrixView<Tdata, backend> view() const;
+    DSmatrixView<Tdata, backend> view(const t_box& box) const;
     // in place operations
     void normalize();
     void normSize();
@@ -75,4 +94,44 @@ private:
     Tdata* mData;
 };
 
+// non-owning strided window on a buffer: element (i, j) lives at
+// data()[i * rowStride + j * colStride], strides are in elements and may
+// be negative (flips). The view never allocates nor frees, so the buffer
+// must outlive it. Being cheap to copy, views are passed by value.
+template <typename Tdata, template <class> class  backend>
+class DSmatrixView
+{
+public:
+    // constructors
+    DSmatrixView(Tdata* base, unsigned int rows, unsigned int cols,
+                 long int rowStride, long int colStride, long int offset = 0);
+    DSmatrixView(const DSmatrix<Tdata, backend>& mat);
+    // operators
+    Tdata& operator()(unsigned int i, unsigned int j) const;
+    // inline info
+    Tdata * data() const;
+    t_dims dims() const;
+    unsigned int size() const;
+    long int rowStride() const;
+    long int colStride() const;
+    long int offset() const;
+    // rows are stored back to back, i.e. the view is a plain matrix
+    bool is_contiguous() const;
+    // derived views
+    DSmatrixView<Tdata, backend> subview(const t_box& box) const;
+    DSmatrixView<Tdata, backend> subsample(unsigned int rowStep,
+                                           unsigned int colStep,
+                                           unsigned int row = 0,
+                                           unsigned int col = 0) const;
+    DSmatrixView<Tdata, backend> transposed() const;
+
+private:
+    Tdata* mBase;
+    unsigned int mRows;
+    unsigned int mCols;
+    long int mRowStride;
+    long int mColStride;
+    long int mOffset;
+};
+
 #endif
@@ -30,8 +30,11 @@
 #ifndef FOURIERTRANSFORM_HPP_
 #define FOURIERTRANSFORM_HPP_
 
+#include <cstddef>
 #include <memory>
+#include <string>
 
+#include "src/fourier/FourierParams.hpp"
 #include "src/backend/cpu/backendCPUfourier.hpp"
 #ifdef CUDA
 #include "src/backend/cuda/backendCUDAfourier.hpp"
@@ -39,6 +42,7 @@
 
 #include "src/dataStructure/dataStruct.hpp"
 #include "src/transform/transformMatrix.hpp"
+#include "src/utils/instrumentation.hpp"
 
 template <typename Tdata,
           template <class> class  backend,
@@ -50,14 +54,43 @@ public:
 
     using complex_type = typename backendC<Tdata>::complex;
 
-    FourierTransformImpl(unsigned int rows, unsigned int cols) 
-     : mRows(rows), mCols(cols) {
-        m_impl = std::shared_ptr<fft_type>(new fft_type(rows, cols));
+    // nThreads > 1 runs each transform on nThreads threads: do not call
+    // such a transform from threads that already use all the cores
+    FourierTransformImpl(unsigned int rows, unsigned int cols,
+                         FFTRigor rigor = FFT_ESTIMATE,
+                         unsigned int nThreads = 1)
+     : m_instr(nullptr), mRows(rows), mCols(cols) {
+        m_impl = fft_type::instance(rows, cols, rigor, nThreads);
     }
     ~FourierTransformImpl() {
         m_impl.reset();
     }
 
+    // Planner wisdom shared by all the transforms of the process: import
+    // it before creating the transforms, export it once they are planned
+    static bool importWisdom(const std::string& fileName) {
+        return fft_type::importWisdom(fileName);
+    }
+
+    static bool exportWisdom(const std::string& fileName) {
+        return fft_type::exportWisdom(fileName);
+    }
+
+    // Transforms of the same shape and options share their plans through a
+    // process-wide cache; this releases the plans no transform uses
+    static void clearPlanCache() {
+        fft_type::clearCache();
+    }
+
+    // Optional per-stage timing, not owned: nullptr (the default) disables it
+    void setInstrumentation(Instrumentation * instr) {
+        m_instr = instr;
+    }
+
+    Instrumentation * instrumentation() const {
+        return m_instr;
+    }
+
     void fft(DSmatrix<complex_type, backendM>& inMat) {
 
         // checks
@@ -65,23 +98,23 @@ public:
         assert(dims.rows == mRows);
         assert(dims.cols == mCols);
 
-        m_impl->fft(inMat.data());
+        implFft(inMat.data());
     }
 
     void fftWithShifts(DSmatrix<complex_type, backendM>& inMat) {
 
-        m_impl->ifftshift(inMat.data());
-        m_impl->fft(inMat.data());
-        m_impl->fftshift(inMat.data());
+        implShift(inMat.data(), true);
+        implFft(inMat.data());
+        implShift(inMat.data(), false);
     }
 
     void fftWithShiftsPadded(const DSmatrix<complex_type, backendM>& inMat ,
                                    DSmatrix<complex_type, backendM>& outMat) {
 
         pad(inMat, outMat);
-        m_impl->ifftshift(outMat.data());
-        m_impl->fft(outMat.data());
-        m_impl->fftshift(outMat.data());
+        implShift(outMat.data(), true);
+        implFft(outMat.data());
+        implShift(outMat.data(), false);
     }
 
     void ifft(DSmatrix<complex_type, backendM>& inMat) {
@@ -91,24 +124,151 @@ public:
         assert(dims.rows == mRows);
         assert(dims.cols == mCols);
 
-        m_impl->ifft(inMat.data());
-        inMat.normSize();
+        implIfft(inMat.data());
     }
 
     void ifftWithShifts(DSmatrix<complex_type, backendM>& inMat) {
 
-        m_impl->ifftshift(inMat.data());
-        m_impl->ifft(inMat.data());
-        m_impl->fftshift(inMat.data());
+        implShift(inMat.data(), true);
+        implIfft(inMat.data());
+        implShift(inMat.data(), false);
     }
 
     void ifftWithShiftsPadded(const DSmatrix<complex_type, backendM>& inMat ,
                                     DSmatrix<complex_type, backendM>& outMat) {
 
         pad(inMat, outMat);
-        m_impl->ifftshift(outMat.data());
-        m_impl->ifft(outMat.data());
-        m_impl->fftshift(outMat.data());
+        implShift(outMat.data(), true);
+        implIfft(outMat.data());
+        implShift(outMat.data(), false);
+    }
+
+    // Real transforms: the spectrum of a real rows x cols matrix is stored
+    // as its non-redundant half, rows x (cols / 2 + 1)
+    void rfft(const DSmatrix<Tdata, backendM>&       inMat ,
+                    DSmatrix<complex_type, backendM>& outMat) {
+
+        // checks
+        assert(inMat.dims().rows == mRows);
+        assert(inMat.dims().cols == mCols);
+        assert(outMat.size() == mRows * (mCols / 2 + 1));
+
+        implRfft(inMat.data(), outMat.data(), false);
+    }
+
+    // inMat is overwritten
+    void irfft(DSmatrix<complex_type, backendM>& inMat ,
+               DSmatrix<Tdata, backendM>&        outMat) {
+
+        // checks
+        assert(inMat.size() == mRows * (mCols / 2 + 1));
+        assert(outMat.dims().rows == mRows);
+        assert(outMat.dims().cols == mCols);
+
+        implIrfft(inMat.data(), outMat.data(), false);
+    }
+
+    // Same result as real2complex followed by fft, with the whole spectrum
+    // in unshifted order
+    void rfftFull(const DSmatrix<Tdata, backendM>&       inMat ,
+                        DSmatrix<complex_type, backendM>& outMat) {
+
+        // checks
+        assert(inMat.dims().rows == mRows);
+        assert(inMat.dims().cols == mCols);
+        assert(outMat.dims().rows == mRows);
+        assert(outMat.dims().cols == mCols);
+
+        implRfft(inMat.data(), outMat.data(), true);
+    }
+
+    // Same result as ifft followed by complex2real; inMat is overwritten
+    void irfftFull(DSmatrix<complex_type, backendM>& inMat ,
+                   DSmatrix<Tdata, backendM>&        outMat) {
+
+        // checks
+        assert(inMat.dims().rows == mRows);
+        assert(inMat.dims().cols == mCols);
+
+        implIrfft(inMat.data(), outMat.data(), true);
+    }
+
+    // Same result as real2complex followed by fftWithShifts: only half of
+    // the spectrum is computed and the rest follows by Hermitian symmetry
+    void rfftWithShifts(const DSmatrix<Tdata, backendM>&       inMat ,
+                              DSmatrix<complex_type, backendM>& outMat) {
+
+        // checks
+        assert(outMat.dims().rows == mRows);
+        assert(outMat.dims().cols == mCols);
+
+        DSmatrix<Tdata, backendM> shifted(mRows, mCols);
+        implShift(inMat.data(), shifted.data(), true);
+        implRfft(shifted.data(), outMat.data(), true);
+        implShift(outMat.data(), false);
+    }
+
+    // Same result as ifftWithShifts followed by complex2real; inMat is
+    // overwritten
+    void irfftWithShifts(DSmatrix<complex_type, backendM>& inMat ,
+                         DSmatrix<Tdata, backendM>&        outMat) {
+
+        // checks
+        assert(inMat.dims().rows == mRows);
+        assert(inMat.dims().cols == mCols);
+
+        DSmatrix<Tdata, backendM> unshifted(mRows, mCols);
+        implShift(inMat.data(), true);
+        implIrfft(inMat.data(), unshifted.data(), true);
+        implShift(unshifted.data(), outMat.data(), false);
+    }
+
+    // Batched variants: inMat stacks howmany rows x cols matrices along
+    // its rows and all of them are transformed by a single batched plan
+    void fftBatch(DSmatrix<complex_type, backendM>& inMat ,
+                  unsigned int                      howmany) {
+
+        // checks
+        assert(inMat.size() == howmany * mRows * mCols);
+
+        implFft(inMat.data(), howmany);
+    }
+
+    void ifftBatch(DSmatrix<complex_type, backendM>& inMat ,
+                   unsigned int                      howmany) {
+
+        // checks
+        assert(inMat.size() == howmany * mRows * mCols);
+
+        implIfft(inMat.data(), howmany);
+    }
+
+    void fftWithShiftsBatch(DSmatrix<complex_type, backendM>& inMat ,
+                            unsigned int                      howmany) {
+
+        // checks
+        assert(inMat.size() == howmany * mRows * mCols);
+
+        unsigned int size = mRows * mCols;
+        for (unsigned int b = 0; b < howmany; ++b)
+            implShift(inMat.data() + b * size, true);
+        implFft(inMat.data(), howmany);
+        for (unsigned int b = 0; b < howmany; ++b)
+            implShift(inMat.data() + b * size, false);
+    }
+
+    void ifftWithShiftsBatch(DSmatrix<complex_type, backendM>& inMat ,
+                             unsigned int                      howmany) {
+
+        // checks
+        assert(inMat.size() == howmany * mRows * mCols);
+
+        unsigned int size = mRows * mCols;
+        for (unsigned int b = 0; b < howmany; ++b)
+            implShift(inMat.data() + b * size, true);
+        implIfft(inMat.data(), howmany);
+        for (unsigned int b = 0; b < howmany; ++b)
+            implShift(inMat.data() + b * size, false);
     }
 
     void fftshift(DSmatrix<complex_type, backendM>& inMat) {
@@ -118,7 +278,7 @@ public:
         assert(dims.rows == mRows);
         assert(dims.cols == mCols);
 
-        m_impl->fftshift(inMat.data());
+        implShift(inMat.data(), false);
     }
 
     void ifftshift(DSmatrix<complex_type, backendM>& inMat) {
@@ -128,20 +288,29 @@ public:
         assert(dims.rows == mRows);
         assert(dims.cols == mCols);
 
-        m_impl->ifftshift(inMat.data());
+        implShift(inMat.data(), true);
     }
 
-    void corrFF2F( const DSmatrix<complex_type, backendM>& A ,
-                   const DSmatrix<complex_type, backendM>& B ,
-                         DSmatrix<complex_type, backendM>& result) {
+    void ifftshift(DSmatrix<Tdata, backendM>& inMat) {
 
         // checks
-        t_dims dims = result.dims();
+        t_dims dims = inMat.dims();
         assert(dims.rows == mRows);
         assert(dims.cols == mCols);
+
+        implShift(inMat.data(), true);
+    }
+
+    void corrFF2F( const DSmatrix<complex_type, backendM>& A ,
+                   const DSmatrix<complex_type, backendM>& B ,
+                         DSmatrix<complex_type, backendM>& result) {
+
+        // checks (pointwise: transposed operands are allowed)
+        assert(result.size() == mRows * mCols);
         assert(A.size() == B.size());
         assert(A.size() == result.size());
 
+        InstrScope scope(m_instr, INSTR_CORRELATE, 3 * complexBytes());
         backendC<Tdata>::op::corrComplex(A.data(), B.data(), result.data(), A.size());
     }
 
@@ -153,6 +322,38 @@ public:
         ifftWithShifts(result);
     }
 
+    // B stores only the box support of a mRows x mCols spectrum which is
+    // zero elsewhere: the product is computed on the box only (the box may
+    // wrap around the edges, as it does for unshifted spectra)
+    void corrFF2F( const DSmatrix<complex_type, backendM>& A       ,
+                   const DSmatrix<complex_type, backendM>& B       ,
+                   const t_box&                            support ,
+                         DSmatrix<complex_type, backendM>& result) {
+
+        // checks
+        assert(result.size() == mRows * mCols);
+        assert(A.size() == result.size());
+        assert(B.dims().rows == support.rows);
+        assert(B.dims().cols == support.cols);
+
+        // A and B are read on the box only, the whole result is written
+        InstrScope scope(m_instr, INSTR_CORRELATE,
+                         complexBytes() + 2 * B.size() * sizeof(complex_type));
+        backendC<Tdata>::op::corrComplexBox(A.data(), B.data(), result.data(),
+                                            mRows, mCols,
+                                            support.row, support.col,
+                                            support.rows, support.cols);
+    }
+
+    void corrFF2D( const DSmatrix<complex_type, backendM>& A       ,
+                   const DSmatrix<complex_type, backendM>& B       ,
+                   const t_box&                            support ,
+                         DSmatrix<complex_type, backendM>& result) {
+
+        corrFF2F(A, B, support, result);
+        ifftWithShifts(result);
+    }
+
     void corrDD2D( DSmatrix<complex_type, backendM>& A ,
                    DSmatrix<complex_type, backendM>& B ,
                    DSmatrix<complex_type, backendM>& result) {
@@ -176,16 +377,35 @@ public:
                    const DSmatrix<complex_type, backendM>& B ,
                          DSmatrix<complex_type, backendM>& result) {
 
-        // checks
-        t_dims dims = result.dims();
-        assert(dims.rows == mRows);
-        assert(dims.cols == mCols);
+        // checks (pointwise: transposed operands are allowed)
+        assert(result.size() == mRows * mCols);
         assert(A.size() == B.size());
         assert(A.size() == result.size());
 
+        InstrScope scope(m_instr, INSTR_CONVOLVE, 3 * complexBytes());
         backendC<Tdata>::op::convComplex(A.data(), B.data(), result.data(), A.size());
     }
 
+    void convFF2F( const DSmatrix<complex_type, backendM>& A       ,
+                   const DSmatrix<complex_type, backendM>& B       ,
+                   const t_box&                            support ,
+                         DSmatrix<complex_type, backendM>& result) {
+
+        // checks
+        assert(result.size() == mRows * mCols);
+        assert(A.size() == result.size());
+        assert(B.dims().rows == support.rows);
+        assert(B.dims().cols == support.cols);
+
+        // A and B are read on the box only, the whole result is written
+        InstrScope scope(m_instr, INSTR_CONVOLVE,
+                         complexBytes() + 2 * B.size() * sizeof(complex_type));
+        backendC<Tdata>::op::convComplexBox(A.data(), B.data(), result.data(),
+                                            mRows, mCols,
+                                            support.row, support.col,
+                                            support.rows, support.cols);
+    }
+
     void convFF2D( const DSmatrix<complex_type, backendM>& A ,
                    const DSmatrix<complex_type, backendM>& B ,
                          DSmatrix<complex_type, backendM>& result) {
@@ -221,9 +441,120 @@ public:
         convFF2F(A, B, result);
     }
 
+    void convDF2F( DSmatrix<complex_type, backendM>& A       ,
+                   DSmatrix<complex_type, backendM>& B       ,
+                   const t_box&                      support ,
+                   DSmatrix<complex_type, backendM>& result) {
+
+        fftWithShifts(A);
+        convFF2F(A, B, support, result);
+    }
+
+    // A is already transformed by fftWithShifts, so that an operand used in
+    // several convolutions is transformed once; B is transformed in place
+    void convFD2F( const DSmatrix<complex_type, backendM>& A ,
+                         DSmatrix<complex_type, backendM>& B ,
+                         DSmatrix<complex_type, backendM>& result) {
+
+        fftWithShifts(B);
+        convFF2F(A, B, result);
+    }
+
+    void convFD2D( const DSmatrix<complex_type, backendM>& A ,
+                         DSmatrix<complex_type, backendM>& B ,
+                         DSmatrix<complex_type, backendM>& result) {
+
+        convFD2F(A, B, result);
+        ifftWithShifts(result);
+    }
+
 private:
     using fft_type = typename backend<Tdata>::fourier;
+
+    std::size_t complexBytes(unsigned int howmany = 1) const {
+        return std::size_t(howmany) * mRows * mCols * sizeof(complex_type);
+    }
+
+    std::size_t realBytes() const {
+        return std::size_t(mRows) * mCols * sizeof(Tdata);
+    }
+
+    std::size_t halfBytes() const {
+        return std::size_t(mRows) * (mCols / 2 + 1) * sizeof(complex_type);
+    }
+
+    // Calls to m_impl, each one timed as a stage when m_instr is set
+
+    void implFft(complex_type * data, unsigned int howmany = 1) {
+
+        InstrScope scope(m_instr, INSTR_FFT, 2 * complexBytes(howmany));
+        if (howmany == 1)
+            m_impl->fft(data);
+        else
+            m_impl->fftBatch(data, howmany);
+    }
+
+    // normalized
+    void implIfft(complex_type * data, unsigned int howmany = 1) {
+
+        InstrScope scope(m_instr, INSTR_IFFT, 4 * complexBytes(howmany));
+        if (howmany == 1)
+            m_impl->ifft(data);
+        else
+            m_impl->ifftBatch(data, howmany);
+        backendM<complex_type>::op::divScalarInPlace(data, howmany * mRows * mCols,
+                                                     complex_type(mRows * mCols));
+    }
+
+    // full: the output is the whole unshifted spectrum instead of its half
+    void implRfft(Tdata * in, complex_type * out, bool full) {
+
+        InstrScope scope(m_instr, INSTR_RFFT,
+                         realBytes() + (full ? 2 * complexBytes() : halfBytes()));
+        m_impl->rfft(in, out);
+        if (full)
+            m_impl->halfToFull(out);
+    }
+
+    // normalized; full: the input is the whole unshifted spectrum, otherwise
+    // it is its half and is overwritten
+    void implIrfft(complex_type * in, Tdata * out, bool full) {
+
+        InstrScope scope(m_instr, INSTR_IRFFT,
+                         (full ? complexBytes() + halfBytes() : halfBytes()) + 3 * realBytes());
+        if (full) {
+            DSmatrix<complex_type, backendM> half(mRows, mCols / 2 + 1);
+            m_impl->fullToHalf(in, half.data());
+            m_impl->irfft(half.data(), out);
+        } else {
+            m_impl->irfft(in, out);
+        }
+        backendM<Tdata>::op::divScalarInPlace(out, mRows * mCols, Tdata(mRows * mCols));
+    }
+
+    // inverse selects ifftshift over fftshift
+    template<typename Tshift>
+    void implShift(Tshift * data, bool inverse) {
+
+        InstrScope scope(m_instr, INSTR_SHIFT, 2 * std::size_t(mRows) * mCols * sizeof(Tshift));
+        if (inverse)
+            m_impl->ifftshift(data);
+        else
+            m_impl->fftshift(data);
+    }
+
+    template<typename Tshift>
+    void implShift(const Tshift * in, Tshift * out, bool inverse) {
+
+        InstrScope scope(m_instr, INSTR_SHIFT, 2 * std::size_t(mRows) * mCols * sizeof(Tshift));
+        if (inverse)
+            m_impl->ifftshift(in, out);
+        else
+            m_impl->fftshift(in, out);
+    }
+
     std::shared_ptr<fft_type> m_impl;
+    Instrumentation * m_instr;
     // Only for checks
     unsigned int mRows;
     unsigned int mCols;
@@ -236,6 +567,11 @@ struct FourierTransform_helper<float, cpu_impl> {
     using type = FourierTransformImpl<float, cpu_fft_impl, cpu_impl, cpu_complex_impl>;
 };
 
+template<>
+struct FourierTransform_helper<double, cpu_impl> {
+    using type = FourierTransformImpl<double, cpu_fft_impl, cpu_impl, cpu_complex_impl>;
+};
+
 #ifdef CUDA
 template<>
 struct FourierTransform_helper<float, cuda_impl> {
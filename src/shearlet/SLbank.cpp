@@ -0,0 +1,257 @@
+/*
+ * @file SLbank.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "src/shearlet/SLbank.hpp"
+
+namespace {
+
+    const char     s_magic[8]  = {'N', 'O', 'I', 'S', 'Y', 'S', 'L', 'B'};
+    const uint32_t s_version   = 3;
+    const uint64_t s_alignment = 64;
+
+    struct t_SLbankHeader {
+        char        magic[8];
+        uint32_t    version;
+        t_SLbankKey key;
+        uint32_t    nShearlets;
+        uint32_t    nLevels;
+        uint64_t    levelsOffset;
+        uint64_t    shearletsOffset;
+        uint64_t    dataOffset;
+        uint64_t    fileSize;
+    };
+
+    struct t_SLbankLevel {
+        int32_t  shearLevel;
+        uint32_t index;
+    };
+
+    // support box of a shearlet and offset of its data from dataOffset
+    struct t_SLbankShearlet {
+        uint32_t row;
+        uint32_t col;
+        uint32_t rows;
+        uint32_t cols;
+        uint64_t offset;
+    };
+
+    inline uint64_t alignUp(uint64_t value) {
+        return (value + s_alignment - 1) / s_alignment * s_alignment;
+    }
+
+    inline uint64_t shearletBytes(const t_SLbankKey& key, const t_box& box) {
+        return alignUp(uint64_t(box.rows) * box.cols * 2 * key.precision);
+    }
+
+    inline uint64_t weightsBytes(const t_SLbankKey& key) {
+        return uint64_t(key.rows) * key.cols * key.precision;
+    }
+
+    inline const t_SLbankHeader * header(const unsigned char * map) {
+        return reinterpret_cast<const t_SLbankHeader *>(map);
+    }
+
+    inline const t_SLbankShearlet * shearletTable(const unsigned char * map) {
+        return reinterpret_cast<const t_SLbankShearlet *>(map + header(map)->shearletsOffset);
+    }
+}
+
+SLbank::SLbank(const std::string& fileName)
+: m_map(nullptr),
+  m_size(0),
+  m_valid(false)
+{
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(t_SLbankHeader)) {
+        ::close(fd);
+        return;
+    }
+
+    // private mapping: pages are shared with the page cache until written
+    void * map = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return;
+
+    m_map  = static_cast<unsigned char *>(map);
+    m_size = st.st_size;
+
+    const t_SLbankHeader * h = header(m_map);
+    m_valid = std::memcmp(h->magic, s_magic, sizeof(s_magic)) == 0 &&
+              h->version == s_version &&
+              h->fileSize == m_size &&
+              h->levelsOffset + h->nLevels * sizeof(t_SLbankLevel) <= h->shearletsOffset &&
+              h->shearletsOffset + h->nShearlets * sizeof(t_SLbankShearlet) <= h->dataOffset &&
+              h->dataOffset <= m_size;
+    if (!m_valid)
+        return;
+
+    // every support box must lie in the matrix and its data in the file
+    const t_SLbankShearlet * table = shearletTable(m_map);
+    uint64_t dataSize = 0;
+    for (unsigned int i = 0; i < h->nShearlets && m_valid; ++i) {
+        t_box box = {table[i].row, table[i].col, table[i].rows, table[i].cols};
+        m_valid = uint64_t(box.row) + box.rows <= h->key.rows &&
+                  uint64_t(box.col) + box.cols <= h->key.cols &&
+                  table[i].offset == dataSize;
+        dataSize += shearletBytes(h->key, box);
+    }
+    m_valid = m_valid && h->dataOffset + dataSize + weightsBytes(h->key) == m_size;
+}
+
+SLbank::~SLbank()
+{
+    if (m_map != nullptr)
+        munmap(m_map, m_size);
+}
+
+bool SLbank::matches(const t_SLbankKey& key) const {
+
+    if (!m_valid)
+        return false;
+
+    const t_SLbankKey& k = header(m_map)->key;
+    return k.rows              == key.rows              &&
+           k.cols              == key.cols              &&
+           k.Nscales           == key.Nscales           &&
+           k.directionalFilter == key.directionalFilter &&
+           k.scalingFilter     == key.scalingFilter     &&
+           k.precision         == key.precision;
+}
+
+unsigned int SLbank::nShearlets() const {
+
+    return header(m_map)->nShearlets;
+}
+
+std::map<int, unsigned int> SLbank::shearLevels() const {
+
+    const t_SLbankHeader * h = header(m_map);
+    const t_SLbankLevel * levels = reinterpret_cast<const t_SLbankLevel *>(m_map + h->levelsOffset);
+
+    std::map<int, unsigned int> out;
+    for (unsigned int i = 0; i < h->nLevels; ++i)
+        out.insert(std::map<int, unsigned int>::value_type(levels[i].shearLevel, levels[i].index));
+    return out;
+}
+
+void * SLbank::shearlet(unsigned int i) const {
+
+    const t_SLbankHeader * h = header(m_map);
+    return m_map + h->dataOffset + shearletTable(m_map)[i].offset;
+}
+
+t_box SLbank::support(unsigned int i) const {
+
+    const t_SLbankShearlet& entry = shearletTable(m_map)[i];
+    return t_box{entry.row, entry.col, entry.rows, entry.cols};
+}
+
+void * SLbank::weights() const {
+
+    const t_SLbankHeader * h = header(m_map);
+    return m_map + h->fileSize - weightsBytes(h->key);
+}
+
+void SLbank::write(const std::string&                  fileName ,
+                   const t_SLbankKey&                  key      ,
+                   const std::map<int, unsigned int>&  levels   ,
+                   const std::vector<const void *>&    shearlets,
+                   const std::vector<t_box>&           supports ,
+                   const void *                        weights  ) {
+
+    std::vector<t_SLbankShearlet> table(shearlets.size());
+    uint64_t dataSize = 0;
+    for (unsigned int i = 0; i < shearlets.size(); ++i) {
+        table[i] = {supports[i].row, supports[i].col,
+                    supports[i].rows, supports[i].cols, dataSize};
+        dataSize += shearletBytes(key, supports[i]);
+    }
+
+    t_SLbankHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, s_magic, sizeof(s_magic));
+    h.version      = s_version;
+    h.key          = key;
+    h.nShearlets   = shearlets.size();
+    h.nLevels      = levels.size();
+    h.levelsOffset    = sizeof(t_SLbankHeader);
+    h.shearletsOffset = h.levelsOffset + h.nLevels * sizeof(t_SLbankLevel);
+    h.dataOffset      = alignUp(h.shearletsOffset + h.nShearlets * sizeof(t_SLbankShearlet));
+    h.fileSize        = h.dataOffset + dataSize + weightsBytes(key);
+
+    // write to a temporary file and rename, so that concurrent readers
+    // never map a partially written bank
+    std::string tmpName = fileName + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("SLbank: cannot open " + tmpName);
+
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        for (const auto& level : levels) {
+            t_SLbankLevel l = {level.first, level.second};
+            out.write(reinterpret_cast<const char *>(&l), sizeof(l));
+        }
+        out.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(t_SLbankShearlet));
+        std::vector<char> padding(s_alignment, 0);
+        out.write(padding.data(), h.dataOffset - h.shearletsOffset - h.nShearlets * sizeof(t_SLbankShearlet));
+        for (unsigned int i = 0; i < shearlets.size(); ++i) {
+            uint64_t bytes = uint64_t(supports[i].rows) * supports[i].cols * 2 * key.precision;
+            out.write(static_cast<const char *>(shearlets[i]), bytes);
+            out.write(padding.data(), shearletBytes(key, supports[i]) - bytes);
+        }
+        out.write(static_cast<const char *>(weights), weightsBytes(key));
+
+        if (!out) {
+            std::remove(tmpName.c_str());
+            throw std::runtime_error("SLbank: cannot write " + tmpName);
+        }
+    }
+
+    if (std::rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        std::remove(tmpName.c_str());
+        throw std::runtime_error("SLbank: cannot rename " + tmpName + " to " + fileName);
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * @file SLbank.hpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SLBANK_HPP_
+#define SLBANK_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <map>
+#include <vector>
+
+#include "src/dataStructure/dataStruct.hpp"
+
+// Key identifying a shearlet bank: a bank on disk is only reused when
+// every field matches the system that is being constructed.
+struct t_SLbankKey {
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t Nscales;
+    int32_t  directionalFilter;
+    int32_t  scalingFilter;
+    uint32_t precision;
+};
+typedef struct t_SLbankKey t_SLbankKey;
+
+// Serialized shearlet bank (shearlet spectra restricted to their support
+// box, dual frame weights and shear level map). The file is memory-mapped copy-on-write, so the
+// data pointers stay valid for the lifetime of the object.
+class SLbank
+{
+public:
+    SLbank(const std::string& fileName);
+    ~SLbank();
+
+    SLbank(const SLbank&) = delete;
+    SLbank& operator=(const SLbank&) = delete;
+
+    bool matches(const t_SLbankKey& key) const;
+    unsigned int nShearlets() const;
+    std::map<int, unsigned int> shearLevels() const;
+    void * shearlet(unsigned int i) const;
+    t_box support(unsigned int i) const;
+    void * weights() const;
+
+    // shearlets and weights must point to host memory
+    static void write(const std::string&                  fileName ,
+                      const t_SLbankKey&                  key      ,
+                      const std::map<int, unsigned int>&  levels   ,
+                      const std::vector<const void *>&    shearlets,
+                      const std::vector<t_box>&           supports ,
+                      const void *                        weights  );
+
+private:
+    unsigned char * m_map;
+    size_t m_size;
+    bool m_valid;
+};
+
+#endif
@@ -340,7 +340,7 @@ DSmatrix<Tdata, backend> SLfilter<Tdata, backend>::generator(SLFilterType type)
                                 -0.0000000e+00,
                                  0.0000000e+00,
                                 -3.0861315e-07,
-                                 0.0000000e+00
+                                 0.0000000e+00,
                                 -3.7033578e-07,
                                  0.0000000e+00,
                                 -4.8143652e-07,
@@ -517,3 +517,4 @@ DSmatrix<Tdata, backend> SLfilter<Tdata, backend>::generator(SLFilterType type)
 
 // CPU
 template struct SLfilter<float, cpu_impl>;
+template struct SLfilter<double, cpu_impl>;
@@ -35,9 +35,13 @@
 #include <cassert>
 #include <algorithm>
 #include <deque>
+#include <thread>
+#include <chrono>
+#include <utility>
 
 #include "src/shearlet/SLsystem.hpp"
 #include "src/shearlet/SLfilter.hpp"
+#include "src/shearlet/SLbank.hpp"
 
 #include "src/dataStructure/dataStruct.hpp"
 #include "src/backend/cpu/backendCPU.hpp"
@@ -48,63 +52,140 @@
 #include "src/fourier/FourierTransform.hpp"
 #include "src/transform/transformMatrix.hpp"
 
+#include "src/utils/selection.hpp"
+
+namespace {
+    // runs fn and, when enabled, stores its wall time in seconds
+    template<typename Tfn>
+    void timed(bool enabled, double& seconds, const Tfn& fn) {
+
+        if (!enabled) {
+            fn();
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+template<typename T, template <class> class  backend>
+SLsystem<T, backend>::SLsystem(unsigned int      rows,
+                               unsigned int      cols,
+                               unsigned int      Nscales,
+                               FFTRigor          rigor,
+                               Instrumentation * instr,
+                               unsigned int      buildThreads) :
+m_rows(rows), m_cols(cols), m_nscales(Nscales), m_rigor(rigor), m_bank(nullptr), m_pool(nullptr),
+m_fftOpThreaded(nullptr), m_instr(instr), m_shiftFree(false), m_weightsUnshifted(nullptr)
+{
+
+    // construct fft operator
+    m_fftOp = new FourierTransform<T, backend>(rows, cols, rigor);
+    m_fftOp->setInstrumentation(m_instr);
+
+    build(rows, cols, buildThreads);
+}
+
 template<typename T, template <class> class  backend>
-SLsystem<T, backend>::SLsystem(unsigned int rows,
-                               unsigned int cols,
-                               unsigned int Nscales) :
-m_rows(rows), m_cols(cols)
+SLsystem<T, backend>::SLsystem(unsigned int       rows    ,
+                               unsigned int       cols    ,
+                               unsigned int       Nscales ,
+                               const std::string& fileName,
+                               FFTRigor           rigor,
+                               Instrumentation *  instr,
+                               unsigned int       buildThreads) :
+m_rows(rows), m_cols(cols), m_nscales(Nscales), m_rigor(rigor), m_bank(nullptr), m_pool(nullptr),
+m_fftOpThreaded(nullptr), m_instr(instr), m_shiftFree(false), m_weightsUnshifted(nullptr)
 {
 
     // construct fft operator
-    m_fftOp = new FourierTransform<T, backend>(rows, cols);
+    m_fftOp = new FourierTransform<T, backend>(rows, cols, rigor);
+    m_fftOp->setInstrumentation(m_instr);
+
+    SLbank * bank = new SLbank(fileName);
+    if (bank->matches(bankKey())) {
+        load(bank);
+    } else {
+        delete bank;
+        build(rows, cols, buildThreads);
+        // the bank is only a cache: a failed write must not fail construction
+        try {
+            save(fileName);
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::build(unsigned int rows,
+                                 unsigned int cols,
+                                 unsigned int nThreads) {
+
+    if (nThreads == 0)
+        nThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    ThreadPool pool(nThreads);
 
     // compute shear levels
-    std::vector<int> shearLevels(Nscales);
-    for (unsigned int i = 1; i <= Nscales; ++i)
-        shearLevels[i-1] = (int)ceil((float)i * 0.5);
+    std::vector<int> shearLevels = computeShearLevels();
 
     // compute filters
-    t_Filters * filters = prepareFilters(rows, cols, shearLevels);
+    t_Filters * filters = prepareFilters(rows, cols, shearLevels, pool);
 
     // compute indices
     std::vector<int> shearletIdxs = computeIdxs(shearLevels);
 
-    // compute shearlets and weights
+    // compute shearlets, keeping only the bounding box of their essential
+    // frequency support: the shearlets are independent
     unsigned int nShearlets = shearletIdxs.size() / 3;
-    for (unsigned int i = 0; i < nShearlets; ++i) {
+    m_shearlets.resize(nShearlets);
+    m_supports.resize(nShearlets);
+    pool.parallelFor(nShearlets, [&](unsigned int i, unsigned int) {
         int cone = shearletIdxs[3*i];
         int scale = shearletIdxs[3*i+1];
         int shearing = shearletIdxs[3*i+2];
 
+        DSmatrixComplex * shearlet;
         if (cone == 0) {
-            m_shearlets.push_back( new DSmatrixComplex( *filters->cone1->lowpass ) );
+            shearlet = new DSmatrixComplex( *filters->cone1->lowpass );
         } else if (cone == 1) {
             unsigned int shearLevel = shearLevels[scale];
-            unsigned int indexLevel = m_shearlevel2index[shearLevel];
+            unsigned int indexLevel = m_shearlevel2index.at(shearLevel);
             unsigned int direction = -shearing + ( 1 << shearLevel );
-            DSmatrixComplex tmp( filters->cone1->wedge[indexLevel]->dir[direction]->dims() );
-            m_fftOp->corrFF2F( *filters->cone1->wedge[indexLevel]->dir[direction] ,
-                               *filters->cone1->bandpass[scale],
-                               tmp);
-            m_shearlets.push_back( new DSmatrixComplex( tmp ) );
+            shearlet = new DSmatrixComplex( filters->cone1->wedge[indexLevel]->dir[direction]->dims() );
+            filters->cone1->op->corrFF2F( *filters->cone1->wedge[indexLevel]->dir[direction] ,
+                                          *filters->cone1->bandpass[scale],
+                                          *shearlet);
         } else {
             unsigned int shearLevel = shearLevels[scale];
-            unsigned int indexLevel = m_shearlevel2index[shearLevel];
+            unsigned int indexLevel = m_shearlevel2index.at(shearLevel);
             unsigned int direction = shearing + ( 1 << shearLevel );
             DSmatrixComplex tmp(filters->cone2->wedge[indexLevel]->dir[direction]->dims());
-            m_fftOp->corrFF2F( *filters->cone2->wedge[indexLevel]->dir[direction] ,
-                               *filters->cone2->bandpass[scale],
-                                tmp);
+            filters->cone2->op->corrFF2F( *filters->cone2->wedge[indexLevel]->dir[direction] ,
+                                          *filters->cone2->bandpass[scale],
+                                          tmp);
             t_dims tmpDims = tmp.dims();
-            DSmatrixComplex tmpTranspose(tmpDims.cols, tmpDims.cols);
-            transpose(tmp, tmpTranspose);
-            m_shearlets.push_back( new DSmatrixComplex( tmpTranspose ) );
+            shearlet = new DSmatrixComplex(tmpDims.cols, tmpDims.rows);
+            transpose(tmp, *shearlet);
         }
-    }
 
-    // compute weights
-    DSmatrixReal reductionMat(m_shearlets[0]->dims());
-    reduceNmat(m_shearlets, reductionMat);
+        t_box box = support(*shearlet, complex_type(s_supportTolerance));
+        m_shearlets[i] = new DSmatrixComplex(box.rows, box.cols);
+        crop(*shearlet, box, *m_shearlets[i]);
+        m_supports[i] = box;
+        delete shearlet;
+    });
+
+    // compute weights from the truncated shearlets, so that the dual frame
+    // stays exact
+    DSmatrixReal reductionMat(rows, cols, T(0));
+    DSmatrixComplex shearletFull(rows, cols);
+    std::vector<DSmatrixComplex*> shearletVec(1, &shearletFull);
+    for (unsigned int i = 0; i < m_shearlets.size(); ++i) {
+        embed(*m_shearlets[i], m_supports[i], shearletFull);
+        reduceNmat(shearletVec, reductionMat);
+    }
     m_weights = new DSmatrixReal( reductionMat );
 
     // clean up
@@ -112,6 +193,7 @@ m_rows(rows), m_cols(cols)
         for (unsigned int i = 0; i < filters->cone1->bandpass.size(); ++i)
             delete filters->cone1->bandpass[i];
         delete filters->cone1->lowpass;
+        delete filters->cone1->op;
         for (unsigned int i = 0; i < filters->cone1->wedge.size(); ++i ) {
             for (unsigned int j = 0; j < filters->cone1->wedge[i]->dir.size(); ++j)
                 delete filters->cone1->wedge[i]->dir[j];
@@ -124,6 +206,7 @@ m_rows(rows), m_cols(cols)
         for (unsigned int i = 0; i < filters->cone2->bandpass.size(); ++i)
             delete filters->cone2->bandpass[i];
         delete filters->cone2->lowpass;
+        delete filters->cone2->op;
         for (unsigned int i = 0; i < filters->cone2->wedge.size(); ++i ) {
             for (unsigned int j = 0; j < filters->cone2->wedge[i]->dir.size(); ++j)
                 delete filters->cone2->wedge[i]->dir[j];
@@ -138,28 +221,91 @@ template<typename T, template <class> class  backend>
 SLsystem<T, backend>::~SLsystem()
 {
     delete m_fftOp;
+    delete m_fftOpThreaded;
     for (unsigned int i = 0; i < m_shearlets.size(); ++i)
         delete m_shearlets[i];
     delete m_weights;
+    delete m_weightsUnshifted;
+    // unmap only after the views on the bank are gone
+    delete m_bank;
+    delete m_pool;
+}
+
+template<typename T, template <class> class  backend>
+t_SLbankKey SLsystem<T, backend>::bankKey() const {
+
+    t_SLbankKey key;
+    key.rows              = m_rows;
+    key.cols              = m_cols;
+    key.Nscales           = m_nscales;
+    key.directionalFilter = s_directionalFilter;
+    key.scalingFilter     = s_scalingFilter;
+    key.precision         = sizeof(T);
+    return key;
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::load(SLbank * bank) {
+
+    m_bank = bank;
+    m_shearlevel2index = bank->shearLevels();
+
+    // shearlets and weights are views on the mapped file
+    for (unsigned int i = 0; i < bank->nShearlets(); ++i) {
+        t_box box = bank->support(i);
+        m_shearlets.push_back( new DSmatrixComplex( box.rows, box.cols,
+                                   static_cast<complex_type *>(bank->shearlet(i)) ) );
+        m_supports.push_back(box);
+    }
+    m_weights = new DSmatrixReal( m_rows, m_cols, static_cast<T *>(bank->weights()) );
 }
 
 template<typename T, template <class> class  backend>
-SLsystem<T, backend>::t_Filters * SLsystem<T, backend>::prepareFilters(unsigned int rows,
+void SLsystem<T, backend>::save(const std::string& fileName) {
+
+    std::vector<const void *> shearlets(m_shearlets.size());
+    for (unsigned int i = 0; i < m_shearlets.size(); ++i)
+        shearlets[i] = m_shearlets[i]->data();
+
+    SLbank::write(fileName, bankKey(), m_shearlevel2index, shearlets, m_supports, m_weights->data());
+}
+
+template<typename T, template <class> class  backend>
+typename SLsystem<T, backend>::t_Filters * SLsystem<T, backend>::prepareFilters(unsigned int rows,
                                      unsigned int cols,
-                                     std::vector<int>& shearLevels) {
+                                     std::vector<int>& shearLevels,
+                                     ThreadPool& pool) {
 
     t_Filters * filters = new t_Filters;
-    filters->cone1 = computeFilters(rows, cols, shearLevels);
-    if (rows == cols)
+    filters->cone1 = new t_FiltersWedgeBandLow;
+    std::vector<t_FiltersWedgeBandLow*> cones(1, filters->cone1);
+    std::vector<t_dims> coneDims(1, t_dims{rows, cols});
+    if (rows == cols) {
         filters->cone2 = filters->cone1;
-    else
-        filters->cone2 = computeFilters(cols, rows, shearLevels);
+    } else {
+        filters->cone2 = new t_FiltersWedgeBandLow;
+        cones.push_back(filters->cone2);
+        coneDims.push_back(t_dims{cols, rows});
+    }
+
+    // both cones are built by the same task graph
+    computeFilters(coneDims, shearLevels, cones, pool);
 
     return filters;
 }
 
 template<typename T, template <class> class  backend>
-std::vector<int> SLsystem<T, backend>::computeIdxs(std::vector<int>& shearLevels) {
+std::vector<int> SLsystem<T, backend>::computeShearLevels() const {
+
+    std::vector<int> shearLevels(m_nscales);
+    for (unsigned int i = 1; i <= m_nscales; ++i)
+        shearLevels[i-1] = (int)ceil((float)i * 0.5);
+
+    return shearLevels;
+}
+
+template<typename T, template <class> class  backend>
+std::vector<int> SLsystem<T, backend>::computeIdxs(std::vector<int>& shearLevels) const {
 
     std::vector<int> idxs;
     for (int cone = 1; cone <= 2; ++cone) {
@@ -179,46 +325,44 @@ std::vector<int> SLsystem<T, backend>::computeIdxs(std::vector<int>& shearLevels
 }
 
 template<typename T, template <class> class  backend>
-SLsystem<T, backend>::t_FiltersWedgeBandLow *
-SLsystem<T, backend>::computeFilters(unsigned int rows,
-                                     unsigned int cols,
-                                     std::vector<int>& shearLevels) {
-
-    t_FiltersWedgeBandLow *filters = new t_FiltersWedgeBandLow;
+void SLsystem<T, backend>::computeFilters(const std::vector<t_dims>& coneDims,
+                                          std::vector<int>& shearLevels,
+                                          std::vector<t_FiltersWedgeBandLow*>& cones,
+                                          ThreadPool& pool) {
 
     unsigned int Nscales = shearLevels.size();
     int maxLevel = *std::max_element(shearLevels.begin(), shearLevels.end()) + 1;
 
-    DSmatrixReal directionalFilter = _SLfilter::generator(SL_DIRECTIONAL1);
+    DSmatrixReal directionalFilter = _SLfilter::generator(s_directionalFilter);
     directionalFilter.normalize();
 
-    DSmatrixReal scalingFilter  = _SLfilter::generator(SL_SCALING);
-    DSmatrixReal scalingFilter2 = _SLfilter::generator(SL_SCALING);
+    DSmatrixReal scalingFilter  = _SLfilter::generator(s_scalingFilter);
+    DSmatrixReal scalingFilter2 = _SLfilter::generator(s_scalingFilter);
     DSmatrixReal waveletFilter  = _SLfilter::mirror(scalingFilter);
 
     std::vector<DSmatrixReal*> filterHigh(Nscales);
     std::vector<DSmatrixReal*> filterLow(Nscales);
     std::vector<DSmatrixReal*> filterLow2(maxLevel);
 
-    filterHigh[Nscales-1]  = new DSmatrixReal(waveletFilter);
-    filterLow[Nscales-1]   = new DSmatrixReal(scalingFilter);
-    filterLow2[maxLevel-1] = new DSmatrixReal(scalingFilter2);
+    filterHigh[Nscales-1]  = new DSmatrixReal(std::move(waveletFilter));
+    filterLow[Nscales-1]   = new DSmatrixReal(std::move(scalingFilter));
+    filterLow2[maxLevel-1] = new DSmatrixReal(std::move(scalingFilter2));
 
-    for (long int i = Nscales-2; i >= 0; --i) {
+    for (long int i = (long int)Nscales-2; i >= 0; --i) {
         unsigned int nzeros = 1;
         DSmatrixReal tmp2( upsample(*filterLow[i+1], 1, nzeros) );
         upsample(*filterLow[i+1], 1, nzeros, &tmp2);
 
         DSmatrixReal tmpConvolve2( convolve(*filterLow[Nscales-1], tmp2) );
         convolve(*filterLow[Nscales-1], tmp2, &tmpConvolve2);
-        filterLow[i] = new DSmatrix( tmpConvolve2 );
+        filterLow[i] = new DSmatrixReal( std::move(tmpConvolve2) );
 
         DSmatrixReal tmp( upsample(*filterHigh[i+1], 1, nzeros) );
         upsample(*filterHigh[i+1], 1, nzeros, &tmp);
 
         DSmatrixReal tmpConvolve( convolve(*filterLow[Nscales-1], tmp) );
         convolve(*filterLow[Nscales-1], tmp, &tmpConvolve);
-        filterHigh[i] = new DSmatrixReal( tmpConvolve );
+        filterHigh[i] = new DSmatrixReal( std::move(tmpConvolve) );
     }
 
     for (long int i = maxLevel-2; i >= 0; --i) {
@@ -228,38 +372,7 @@ SLsystem<T, backend>::computeFilters(unsigned int rows,
 
         DSmatrixReal tmp2( convolve(*filterLow2[maxLevel-1], tmp) );
         convolve(*filterLow2[maxLevel-1], tmp, &tmp2);
-        filterLow2[i] = new DSmatrixReal( tmp2 );
-    }
-
-    DSmatrixComplex filterPaddedFFT(rows, cols);
-    for (unsigned int i = 0; i < Nscales; ++i) {
-        DSmatrixComplex filterHighComplex(filterHigh[i]->dims());
-        real2complex(*filterHigh[i], filterHighComplex);
-        m_fftOp->fftWithShiftsPadded(filterHighComplex, filterPaddedFFT);
-        filters->bandpass.push_back( new DSmatrixComplex( filterPaddedFFT ) );
-    }
-
-    {
-        // transpose
-        t_dims filterLowDims = filterLow[0]->dims();
-        DSmatrixReal filterLow0Transpose(filterLowDims.cols, filterLowDims.rows);
-        transpose(*filterLow[0], filterLow0Transpose);
-        // matrix-matrix mult
-        DSmatrixReal filterLowMatMul(filterLowDims.rows, filterLowDims.rows);
-        matMul(*filterLow[0], filterLow0Transpose, filterLowMatMul);
-        // convert DSmatrixReal to DSmatrixComplex
-        DSmatrixComplex filterLowComplex(filterLowMatMul.dims());
-        real2complex(filterLowMatMul, filterLowComplex);
-        // fourier transform
-        DSmatrixComplex lowpass(rows, cols);
-        m_fftOp->fftWithShiftsPadded(filterLowComplex, lowpass);
-        // add to struct
-        filters->lowpass = new DSmatrixComplex(lowpass);
-    }
-
-    for (unsigned int i = 0; i < Nscales; ++i) {
-        delete filterHigh[i];
-        delete filterLow[i];
+        filterLow2[i] = new DSmatrixReal( std::move(tmp2) );
     }
 
     std::vector<int> shearLevelsUnique = shearLevels;
@@ -271,78 +384,204 @@ SLsystem<T, backend>::computeFilters(unsigned int rows,
     // Resizing the vector so as to remove the undefined terms
     shearLevelsUnique.resize(std::distance(shearLevelsUnique.begin(), ip));
 
-    for (unsigned int level = 0; level < shearLevelsUnique.size(); ++level) {
+    unsigned int nCones = cones.size();
+    unsigned int nLevels = shearLevelsUnique.size();
+    std::vector<t_LevelPlan> plans(nCones * nLevels);
+    for (unsigned int c = 0; c < nCones; ++c) {
+
+        // the spectra of cone c are transforms of its own shape (the plans
+        // come from the cache)
+        cones[c]->op = new FourierTransform<T, backend>(coneDims[c].rows, coneDims[c].cols, m_rigor);
+        cones[c]->op->setInstrumentation(m_instr);
+        cones[c]->bandpass.resize(Nscales);
+
+        for (unsigned int level = 0; level < nLevels; ++level) {
+
+            int shearLevel = shearLevelsUnique[level];
+
+            // mapping between shearlevel and memory index of the wedge filter
+            m_shearlevel2index.insert(std::map<int, unsigned int>::value_type(shearLevel, level));
+
+            t_LevelPlan& plan = plans[c * nLevels + level];
+            plan.dims = coneDims[c];
+            plan.coneOp = cones[c]->op;
+            plan.shearLevel = shearLevel;
+            plan.directions = new t_FilterDirections;
+            plan.directions->dir.resize((2 << shearLevel) + 1, nullptr);
+            // one slot per direction and one for prepareLevel
+            plan.seconds.assign((2 << shearLevel) + 2, 0.0);
+            cones[c]->wedge.push_back(plan.directions);
+        }
+    }
+
+    bool timing = m_instr != nullptr;
+
+    // first stage: bandpass filters, lowpass filter and the data shared by
+    // the directions of each shear level, for every cone
+    unsigned int nTasks = Nscales + 1 + nLevels;
+    pool.parallelFor(nCones * nTasks, [&](unsigned int task, unsigned int) {
+
+        unsigned int c = task / nTasks;
+        unsigned int j = task % nTasks;
+
+        if (j < Nscales) {
+            DSmatrixComplex filterHighComplex(filterHigh[j]->dims());
+            real2complex(*filterHigh[j], filterHighComplex);
+            DSmatrixComplex * bandpass = new DSmatrixComplex(coneDims[c]);
+            cones[c]->op->fftWithShiftsPadded(filterHighComplex, *bandpass);
+            cones[c]->bandpass[j] = bandpass;
+        } else if (j == Nscales) {
+            // transpose
+            t_dims filterLowDims = filterLow[0]->dims();
+            DSmatrixReal filterLow0Transpose(filterLowDims.cols, filterLowDims.rows);
+            transpose(*filterLow[0], filterLow0Transpose);
+            // matrix-matrix mult (outer product)
+            DSmatrixReal filterLowMatMul(filterLowDims.cols, filterLowDims.cols, T(0));
+            matMul(filterLow0Transpose, *filterLow[0], filterLowMatMul);
+            // convert DSmatrixReal to DSmatrixComplex
+            DSmatrixComplex filterLowComplex(filterLowMatMul.dims());
+            real2complex(filterLowMatMul, filterLowComplex);
+            // fourier transform
+            DSmatrixComplex * lowpass = new DSmatrixComplex(coneDims[c]);
+            cones[c]->op->fftWithShiftsPadded(filterLowComplex, *lowpass);
+            // add to struct
+            cones[c]->lowpass = lowpass;
+        } else {
+            t_LevelPlan& plan = plans[c * nLevels + j - Nscales - 1];
+            timed(timing, plan.seconds.back(), [&]() {
+                prepareLevel(plan, directionalFilter, filterLow2);
+            });
+        }
+    });
 
-        t_FilterDirections * directions = new t_FilterDirections;
+    // second stage: every direction of every shear level and cone, the
+    // largest levels first so that the last tasks are the shortest
+    std::vector<std::pair<unsigned int, int>> directionTasks;
+    for (unsigned int level = nLevels; level-- > 0; ) {
         int shearLevel = shearLevelsUnique[level];
+        for (unsigned int c = 0; c < nCones; ++c)
+            for (int k = -(1 << shearLevel); k <= (1 << shearLevel); ++k)
+                directionTasks.emplace_back(c * nLevels + level, k);
+    }
 
-        // mapping between shearlevel and memory index of the wedge filter
-        m_shearlevel2index.insert(std::map<int, unsigned int>::value_type(shearLevel, level));
-
-        // upsample the directional filter
-        DSmatrixReal directionalFilterUpsampled( upsample(directionalFilter, 0, (1 << (shearLevel+1)) - 1) );
-        upsample(directionalFilter, 0, (1 << (shearLevel+1)) - 1, &directionalFilterUpsampled);
-        // transpose low2 filter (needed for convolution function)
-        t_dims filterLow2Dims = filterLow2[filterLow2.size()-1-shearLevel]->dims();
-        DSmatrixReal filterLow2Transpose(filterLow2Dims.cols, filterLow2Dims.rows);
-        transpose(*filterLow2[filterLow2.size()-1-shearLevel], filterLow2Transpose);
-        // data domain convolution of directionalFilterUpsampled and filterLow2Transpose
-        DSmatrixReal wedgeHelp( convolve(directionalFilterUpsampled, filterLow2Transpose) );
-        convolve(directionalFilterUpsampled, filterLow2Transpose, &wedgeHelp);
-        // pad
-        DSmatrixReal wedgeHelpPad(rows, cols);
-        pad(wedgeHelp, wedgeHelpPad);
-        // upsampled
-        DSmatrixReal wedgeHelpUpsampled( upsample(wedgeHelpPad, 1, (1 << shearLevel) - 1) );
-        upsample(wedgeHelpPad, 1, (1 << shearLevel) - 1, &wedgeHelpUpsampled);
-
-        // pad low2 filter
-        t_dims dimsUpsampled = wedgeHelpUpsampled.dims();
-        DSmatrixReal lowpassHelp(dimsUpsampled.rows, dimsUpsampled.cols);
-        pad(*filterLow2[maxLevel-1-std::max(shearLevel-1, 0)], lowpassHelp);
-
-        // temporary FFT operator
-        FourierTransform<T, backend> FFTOp(dimsUpsampled.rows, dimsUpsampled.cols);
-
-        // convolve lowpassHelp and wedgeHelpUpsampled (from data to data domain)
-        DSmatrixComplex lowpassHelpComplex( lowpassHelp.dims() );
-        real2complex(lowpassHelp, lowpassHelpComplex);
-        DSmatrixComplex wedgeHelpUpsampledComplex( wedgeHelpUpsampled.dims() );
-        real2complex(wedgeHelpUpsampled, wedgeHelpUpsampledComplex);
-        DSmatrixComplex wedgeConv(dimsUpsampled);
-        FFTOp.convDD2D(lowpassHelpComplex, wedgeHelpUpsampledComplex, wedgeConv);
-
-        // flip columns of lowPassHelpComplex
-        lowpassHelpComplex.fliplr(1);
-
-        // temporary matrices
-        t_dims dimsWedgeConv = wedgeConv.dims();
-        DSmatrixComplex wedgeUpsampledSheared(dimsWedgeConv);
-        DSmatrixComplex wedgeUpsampledConv(dimsWedgeConv);
-        DSmatrixComplex wedgeDownsampledConv(rows, cols);
-
-        // directions
-        for (long int k = -(1 << shearLevel); k <= (1 << shearLevel); ++k) {
-
-            // apply dshear operator to wedgeConv
-            dshear(wedgeConv, wedgeUpsampledSheared, k, 1);
-            // convolve lowpassHelpFlip and wedgeUpsampledSheared (from data to data domain)
-            FFTOp.convDD2D(lowpassHelpComplex, wedgeUpsampledSheared, wedgeUpsampledConv);
-            // downsample wedgeUpsampledConv to (rows,cols)
-            downsample(wedgeUpsampledConv, 1, 1 << shearLevel, &wedgeDownsampledConv);
-            // apply scaling factor
-            wedgeDownsampledConv *= (T)(1 << shearLevel);
-            // FFT of wedgeDownsampledConv
-            m_fftOp->fftWithShifts(wedgeDownsampledConv);
-            directions->dir.push_front( new DSmatrixComplex( wedgeDownsampledConv ) );
+    std::vector<t_DirectionScratch> scratch(pool.size());
+    pool.parallelFor(directionTasks.size(), [&](unsigned int task, unsigned int worker) {
+
+        t_LevelPlan& plan = plans[directionTasks[task].first];
+        int k = directionTasks[task].second;
+        timed(timing, plan.seconds[k + (1 << plan.shearLevel)], [&]() {
+            filterDirection(plan, k, scratch[worker]);
+        });
+    });
+
+    // one event per shear level and cone, with the time of its tasks
+    for (t_LevelPlan& plan : plans) {
+        if (timing) {
+            double seconds = 0.0;
+            for (double s : plan.seconds)
+                seconds += s;
+            m_instr->record(INSTR_FILTERS, plan.shearLevel, seconds,
+                            plan.directions->dir.size() * plan.dims.rows * plan.dims.cols *
+                            sizeof(complex_type));
         }
-        filters->wedge.push_back(directions);
+        delete plan.op;
+        delete plan.wedgeConv;
+        delete plan.lowpassSpectrum;
+    }
+
+    for (t_DirectionScratch& buffers : scratch) {
+        delete buffers.sheared;
+        delete buffers.conv;
+    }
+
+    for (unsigned int i = 0; i < Nscales; ++i) {
+        delete filterHigh[i];
+        delete filterLow[i];
     }
 
     for (unsigned int i = 0; i < maxLevel; ++i)
         delete filterLow2[i];
+}
 
-    return filters;
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::prepareLevel(t_LevelPlan& plan,
+                                        const DSmatrixReal& directionalFilter,
+                                        const std::vector<DSmatrixReal*>& filterLow2) {
+
+    unsigned int rows = plan.dims.rows;
+    unsigned int cols = plan.dims.cols;
+    int shearLevel = plan.shearLevel;
+    int maxLevel = filterLow2.size();
+
+    // upsample the directional filter
+    DSmatrixReal directionalFilterUpsampled( upsample(directionalFilter, 0, (1 << (shearLevel+1)) - 1) );
+    upsample(directionalFilter, 0, (1 << (shearLevel+1)) - 1, &directionalFilterUpsampled);
+    // transpose low2 filter (needed for convolution function)
+    t_dims filterLow2Dims = filterLow2[maxLevel-1-shearLevel]->dims();
+    DSmatrixReal filterLow2Transpose(filterLow2Dims.cols, filterLow2Dims.rows);
+    transpose(*filterLow2[maxLevel-1-shearLevel], filterLow2Transpose);
+    // data domain convolution of directionalFilterUpsampled and filterLow2Transpose
+    DSmatrixReal wedgeHelp( convolve(directionalFilterUpsampled, filterLow2Transpose) );
+    convolve(directionalFilterUpsampled, filterLow2Transpose, &wedgeHelp);
+    // pad
+    DSmatrixReal wedgeHelpPad(rows, cols);
+    pad(wedgeHelp, wedgeHelpPad);
+    // upsampled
+    DSmatrixReal wedgeHelpUpsampled( upsample(wedgeHelpPad, 1, (1 << shearLevel) - 1) );
+    upsample(wedgeHelpPad, 1, (1 << shearLevel) - 1, &wedgeHelpUpsampled);
+
+    // pad low2 filter
+    t_dims dimsUpsampled = wedgeHelpUpsampled.dims();
+    DSmatrixReal lowpassHelp(dimsUpsampled.rows, dimsUpsampled.cols);
+    pad(*filterLow2[maxLevel-1-std::max(shearLevel-1, 0)], lowpassHelp);
+
+    // FFT operator of the level, shared by its directions
+    plan.op = new FourierTransform<T, backend>(dimsUpsampled.rows, dimsUpsampled.cols);
+    plan.op->setInstrumentation(m_instr);
+
+    // convolve lowpassHelp and wedgeHelpUpsampled (from data to data domain)
+    DSmatrixComplex lowpassHelpComplex( lowpassHelp.dims() );
+    real2complex(lowpassHelp, lowpassHelpComplex);
+    DSmatrixComplex wedgeHelpUpsampledComplex( wedgeHelpUpsampled.dims() );
+    real2complex(wedgeHelpUpsampled, wedgeHelpUpsampledComplex);
+    plan.wedgeConv = new DSmatrixComplex(dimsUpsampled);
+    plan.op->convDD2D(lowpassHelpComplex, wedgeHelpUpsampledComplex, *plan.wedgeConv);
+
+    // flip columns of lowpassHelp (convDD2D transforms its inputs in place)
+    // and transform it once for all the directions
+    lowpassHelp.fliplr(1);
+    real2complex(lowpassHelp, lowpassHelpComplex);
+    plan.op->fftWithShifts(lowpassHelpComplex);
+    plan.lowpassSpectrum = new DSmatrixComplex(std::move(lowpassHelpComplex));
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::filterDirection(t_LevelPlan& plan, int k, t_DirectionScratch& scratch) {
+
+    int shearLevel = plan.shearLevel;
+
+    t_dims dims = plan.wedgeConv->dims();
+    if (scratch.dims.rows != dims.rows || scratch.dims.cols != dims.cols) {
+        delete scratch.sheared;
+        delete scratch.conv;
+        scratch.sheared = new DSmatrixComplex(dims);
+        scratch.conv = new DSmatrixComplex(dims);
+        scratch.dims = dims;
+    }
+
+    // apply dshear operator to wedgeConv
+    dshear(*plan.wedgeConv, *scratch.sheared, k, 1);
+    // convolve lowpassHelpFlip and the sheared wedge (from data to data domain)
+    plan.op->convFD2D(*plan.lowpassSpectrum, *scratch.sheared, *scratch.conv);
+    // downsample to the size of the cone
+    DSmatrixComplex * direction = new DSmatrixComplex(plan.dims);
+    downsample(*scratch.conv, 1, 1 << shearLevel, direction);
+    // apply scaling factor
+    *direction *= (T)(1 << shearLevel);
+    // FFT of the direction
+    plan.coneOp->fftWithShifts(*direction);
+    // the directions are stored from k = 2^shearLevel down to -2^shearLevel
+    plan.directions->dir[(1 << shearLevel) - k] = direction;
 }
 
 template<typename T, template <class> class  backend>
@@ -355,34 +594,541 @@ SLcoeffs<typename backend<T>::complex, backend> SLsystem<T, backend>::decode(DSm
     SLcoeffs<typename backend<T>::complex, backend> coeffs;
 
     DSmatrixComplex imageComplex(dims);
-    real2complex(image, imageComplex);
-    m_fftOp->fftWithShifts(imageComplex);
+    forwardRFFT(*serialFFTOp(), image, imageComplex);
+
+    if (m_pool == nullptr) {
+
+        for (unsigned int i = 0; i < m_shearlets.size(); ++i) {
+            DSmatrixComplex coeffsImage(dims);
+            analyze(*m_fftOp, i, imageComplex, coeffsImage);
+            coeffs.addElement( std::move(coeffsImage) );
+        }
+        return coeffs;
+    }
+
+    // parallel mode: each shearlet is correlated and transformed in its own
+    // output buffer, so workers share only read-only data (the image
+    // spectrum, the shearlets and the FFTW plans)
+    std::vector<DSmatrixComplex*> coeffsImages(m_shearlets.size());
+    for (unsigned int i = 0; i < m_shearlets.size(); ++i)
+        coeffsImages[i] = coeffs.newElement(dims);
+
+    m_pool->parallelFor(m_shearlets.size(), [&](unsigned int i, unsigned int) {
+        analyze(*m_fftOp, i, imageComplex, *coeffsImages[i]);
+    });
+
+    return coeffs;
+}
+
+template<typename T, template <class> class  backend>
+DSmatrix<T, backend> SLsystem<T, backend>::denoise(DSmatrixReal &image, std::vector<complex_type>& thresholds) {
 
+    std::vector<T> magnitudes(thresholds.size());
+    for (unsigned int i = 0; i < thresholds.size(); ++i)
+        magnitudes[i] = std::abs(thresholds[i]);
+
+    return denoise(image, magnitudes, THRESHOLD_HARD);
+}
+
+template<typename T, template <class> class  backend>
+DSmatrix<T, backend> SLsystem<T, backend>::denoise(DSmatrixReal          &image     ,
+                                                   const std::vector<T>&  thresholds,
+                                                   ThresholdRule          rule      ,
+                                                   T                      firmRatio ) {
+
+    t_dims dims = image.dims();
+    assert(dims.rows == m_rows);
+    assert(dims.cols == m_cols);
+    assert(thresholds.size() == m_shearlets.size());
+
+    DSmatrixComplex imageComplex(dims);
+    forwardRFFT(*serialFFTOp(), image, imageComplex);
+
+    // each worker owns a coefficient buffer, a product buffer and an
+    // accumulator, so memory does not depend on the number of shearlets
+    unsigned int nWorkers = m_pool == nullptr ? 1 : m_pool->size();
+    std::vector<DSmatrixComplex*> coeffsImage(nWorkers);
+    std::vector<DSmatrixComplex*> matConv(nWorkers);
+    std::vector<DSmatrixComplex*> recovered(nWorkers);
+    for (unsigned int w = 0; w < nWorkers; ++w) {
+        coeffsImage[w] = new DSmatrixComplex(dims);
+        matConv[w] = new DSmatrixComplex(dims);
+        recovered[w] = new DSmatrixComplex(m_rows, m_cols, complex_type(0));
+    }
+
+    auto denoiseShearlet = [&](unsigned int i, unsigned int worker) {
+
+        analyze(*m_fftOp, i, imageComplex, *coeffsImage[worker]);
+        backend<complex_type>::op::shrink(coeffsImage[worker]->data(), coeffsImage[worker]->size(), rule,
+                                          complex_type(thresholds[i]),
+                                          complex_type(firmRatio * thresholds[i]));
+        synthesize(*m_fftOp, i, *coeffsImage[worker], *matConv[worker]);
+        accumulate(*recovered[worker], *matConv[worker]);
+    };
+
+    if (m_pool == nullptr) {
+        for (unsigned int i = 0; i < m_shearlets.size(); ++i)
+            denoiseShearlet(i, 0);
+    } else {
+        m_pool->parallelFor(m_shearlets.size(), denoiseShearlet);
+    }
+
+    for (unsigned int w = 1; w < nWorkers; ++w)
+        accumulate(*recovered[0], *recovered[w]);
+
+    normalize(*recovered[0]);
+
+    DSmatrixReal resultReal(m_rows, m_cols);
+    inverseRFFT(*serialFFTOp(), *recovered[0], resultReal);
+
+    for (unsigned int w = 0; w < nWorkers; ++w) {
+        delete coeffsImage[w];
+        delete matConv[w];
+        delete recovered[w];
+    }
+
+    return resultReal;
+}
+
+template<typename T, template <class> class  backend>
+std::vector<T> SLsystem<T, backend>::noiseLevels() const {
+
+    // white noise of variance 1 has a spectrum of variance rows * cols and
+    // the inverse transform divides by rows * cols
+    std::vector<T> levels(m_shearlets.size());
     for (unsigned int i = 0; i < m_shearlets.size(); ++i) {
-        DSmatrixComplex coeffsImage(dims);
-        m_fftOp->corrFF2D(imageComplex, *m_shearlets[i], coeffsImage);
-        coeffs.addElement( coeffsImage );
+        complex_type norm2;
+        normL2(*m_shearlets[i], &norm2);
+        levels[i] = std::sqrt(std::real(norm2) / (T(m_rows) * T(m_cols)));
     }
 
+    return levels;
+}
+
+template<typename T, template <class> class  backend>
+std::vector<T> SLsystem<T, backend>::thresholds(T sigma, const std::vector<T>& factors) const {
+
+    std::vector<T> levels = noiseLevels();
+    std::vector<T> result(m_shearlets.size());
+
+    if (factors.size() == m_shearlets.size()) {
+        for (unsigned int i = 0; i < m_shearlets.size(); ++i)
+            result[i] = factors[i] * sigma * levels[i];
+        return result;
+    }
+
+    assert(factors.size() == m_nscales);
+
+    // (cone, scale, shearing) of each shearlet, cone 0 for the lowpass
+    std::vector<int> shearLevels = computeShearLevels();
+    std::vector<int> shearletIdxs = computeIdxs(shearLevels);
+    for (unsigned int i = 0; i < m_shearlets.size(); ++i) {
+        int cone = shearletIdxs[3*i];
+        int scale = shearletIdxs[3*i+1];
+        result[i] = cone == 0 ? T(0) : factors[scale] * sigma * levels[i];
+    }
+
+    return result;
+}
+
+template<typename T, template <class> class  backend>
+std::vector<unsigned int> SLsystem<T, backend>::finestShearlets() const {
+
+    std::vector<int> shearLevels = computeShearLevels();
+    std::vector<int> shearletIdxs = computeIdxs(shearLevels);
+    std::vector<unsigned int> finest;
+    for (unsigned int i = 0; i < m_shearlets.size(); ++i)
+        if (shearletIdxs[3*i] == 1 && shearletIdxs[3*i+1] == int(m_nscales) - 1)
+            finest.push_back(i);
+
+    return finest;
+}
+
+template<typename T, template <class> class  backend>
+template<typename Tsource>
+T SLsystem<T, backend>::noiseFromShearlets(const std::vector<unsigned int>& finest, const Tsource& coefficients) {
+
+    std::vector<T> levels = noiseLevels();
+    std::size_t size = std::size_t(m_rows) * m_cols;
+    unsigned int nWorkers = m_pool == nullptr ? 1 : m_pool->size();
+    std::vector<std::vector<T>> samples(nWorkers, std::vector<T>(size));
+
+    // |coefficient| / noise level of shearlet finest[j], in the buffer of
+    // the worker
+    auto sample = [&](unsigned int j, unsigned int worker) {
+        const complex_type * coeffs = coefficients(j, worker);
+        T level = levels[finest[j]];
+        T * out = samples[worker].data();
+        for (std::size_t k = 0; k < size; ++k)
+            out[k] = std::abs(std::real(coeffs[k])) / level;
+        return out;
+    };
+
+    auto forEachShearlet = [&](const ThreadPool::task_type& task) {
+        if (m_pool == nullptr) {
+            for (unsigned int j = 0; j < finest.size(); ++j)
+                task(j, 0);
+        } else {
+            m_pool->parallelFor(finest.size(), task);
+        }
+    };
+
+    // the median is selected from a histogram of the first pass and the
+    // values of its bin in the second one
+    RankSelector<T> median(finest.size() * size / 2, nWorkers);
+    forEachShearlet([&](unsigned int j, unsigned int worker) {
+        median.count(sample(j, worker), size, worker);
+    });
+    median.locate();
+    forEachShearlet([&](unsigned int j, unsigned int worker) {
+        median.collect(sample(j, worker), size, worker);
+    });
+
+    // the median of |N(0, 1)|
+    const T medianAbsNormal = T(0.6744897501960817);
+    return median.select() / medianAbsNormal;
+}
+
+template<typename T, template <class> class  backend>
+T SLsystem<T, backend>::estimateNoise(DSmatrixReal &image) {
+
+    t_dims dims = image.dims();
+    assert(dims.rows == m_rows);
+    assert(dims.cols == m_cols);
+
+    DSmatrixComplex imageComplex(dims);
+    forwardRFFT(*serialFFTOp(), image, imageComplex);
+
+    // each worker analyzes into its own buffer, twice per shearlet: memory
+    // does not depend on the number of shearlets
+    unsigned int nWorkers = m_pool == nullptr ? 1 : m_pool->size();
+    std::vector<DSmatrixComplex*> coeffsImage(nWorkers);
+    for (unsigned int w = 0; w < nWorkers; ++w)
+        coeffsImage[w] = new DSmatrixComplex(dims);
+
+    std::vector<unsigned int> finest = finestShearlets();
+    T sigma = noiseFromShearlets(finest, [&](unsigned int j, unsigned int worker) {
+        analyze(*m_fftOp, finest[j], imageComplex, *coeffsImage[worker]);
+        return static_cast<const complex_type *>(coeffsImage[worker]->data());
+    });
+
+    for (unsigned int w = 0; w < nWorkers; ++w)
+        delete coeffsImage[w];
+
+    return sigma;
+}
+
+template<typename T, template <class> class  backend>
+T SLsystem<T, backend>::estimateNoise(SLcoeffs<complex_type, backend> &coeffs) {
+
+    assert(coeffs.size() == m_shearlets.size());
+
+    std::vector<unsigned int> finest = finestShearlets();
+    return noiseFromShearlets(finest, [&](unsigned int j, unsigned int) {
+        assert(coeffs.getElement(finest[j])->size() == m_rows * m_cols);
+        return static_cast<const complex_type *>(coeffs.getElement(finest[j])->data());
+    });
+}
+
+template<typename T, template <class> class  backend>
+std::vector<T> SLsystem<T, backend>::estimateThresholds(DSmatrixReal &image, const std::vector<T>& factors) {
+
+    return thresholds(estimateNoise(image), factors);
+}
+
+template<typename T, template <class> class  backend>
+std::vector<SLcoeffs<typename backend<T>::complex, backend>> SLsystem<T, backend>::decodeBatch(std::vector<DSmatrixReal>& images) {
+
+    unsigned int nImages = images.size();
+    unsigned int size = m_rows * m_cols;
+    t_dims dims = {m_rows, m_cols};
+
+    std::vector<SLcoeffs<complex_type, backend>> coeffs(nImages);
+    if (nImages == 0)
+        return coeffs;
+
+    // spectra of all the images, stacked along the rows
+    DSmatrixComplex imagesComplex(nImages * m_rows, m_cols);
+    for (unsigned int b = 0; b < nImages; ++b) {
+        assert(images[b].dims().rows == m_rows);
+        assert(images[b].dims().cols == m_cols);
+        DSmatrixComplex imageComplex(m_rows, m_cols, imagesComplex.data() + b * size);
+        InstrScope scope(m_instr, INSTR_REAL2COMPLEX, size * (sizeof(T) + sizeof(complex_type)));
+        real2complex(images[b], imageComplex);
+    }
+    forwardFFTBatch(*serialFFTOp(), imagesComplex, nImages);
+
+    std::vector<std::vector<DSmatrixComplex*>> coeffsImages(nImages);
+    for (unsigned int b = 0; b < nImages; ++b)
+        for (unsigned int i = 0; i < m_shearlets.size(); ++i)
+            coeffsImages[b].push_back(coeffs[b].newElement(dims));
+
+    // one batch buffer per worker
+    unsigned int nWorkers = m_pool == nullptr ? 1 : m_pool->size();
+    std::vector<DSmatrixComplex*> batch(nWorkers);
+    for (unsigned int w = 0; w < nWorkers; ++w)
+        batch[w] = new DSmatrixComplex(nImages * m_rows, m_cols);
+
+    auto decodeShearlet = [&](unsigned int i, unsigned int worker) {
+
+        // the shearlet stays in cache while it is applied to every image
+        for (unsigned int b = 0; b < nImages; ++b) {
+            DSmatrixComplex imageComplex(m_rows, m_cols, imagesComplex.data() + b * size);
+            DSmatrixComplex coeffsImage(m_rows, m_cols, batch[worker]->data() + b * size);
+            m_fftOp->corrFF2F(imageComplex, *m_shearlets[i], activeSupport(i), coeffsImage);
+        }
+        inverseFFTBatch(*m_fftOp, *batch[worker], nImages);
+
+        for (unsigned int b = 0; b < nImages; ++b)
+            backend<complex_type>::memory::copy(coeffsImages[b][i]->data(),
+                                                batch[worker]->data() + b * size,
+                                                size);
+    };
+
+    if (m_pool == nullptr) {
+        for (unsigned int i = 0; i < m_shearlets.size(); ++i)
+            decodeShearlet(i, 0);
+    } else {
+        m_pool->parallelFor(m_shearlets.size(), decodeShearlet);
+    }
+
+    for (unsigned int w = 0; w < nWorkers; ++w)
+        delete batch[w];
+
     return coeffs;
 }
 
+template<typename T, template <class> class  backend>
+std::vector<DSmatrix<T, backend>> SLsystem<T, backend>::recoverBatch(std::vector<SLcoeffs<typename backend<T>::complex, backend>>& coeffs) {
+
+    unsigned int nImages = coeffs.size();
+    unsigned int size = m_rows * m_cols;
+
+    std::vector<DSmatrixReal> results;
+    results.reserve(nImages);
+    if (nImages == 0)
+        return results;
+
+    for (unsigned int b = 0; b < nImages; ++b)
+        assert(coeffs[b].size() == m_shearlets.size());
+
+    // each worker owns a batch buffer, a product buffer and an accumulator
+    unsigned int nWorkers = m_pool == nullptr ? 1 : m_pool->size();
+    std::vector<DSmatrixComplex*> batch(nWorkers);
+    std::vector<DSmatrixComplex*> matConv(nWorkers);
+    std::vector<DSmatrixComplex*> imagesComplex(nWorkers);
+    for (unsigned int w = 0; w < nWorkers; ++w) {
+        batch[w] = new DSmatrixComplex(nImages * m_rows, m_cols);
+        matConv[w] = new DSmatrixComplex(m_rows, m_cols);
+        imagesComplex[w] = new DSmatrixComplex(nImages * m_rows, m_cols, complex_type(0));
+    }
+
+    auto recoverShearlet = [&](unsigned int i, unsigned int worker) {
+
+        // the coefficients are copied, so unlike recover the input is left untouched
+        for (unsigned int b = 0; b < nImages; ++b)
+            backend<complex_type>::memory::copy(batch[worker]->data() + b * size,
+                                                coeffs[b].getElement(i)->data(),
+                                                size);
+        forwardFFTBatch(*m_fftOp, *batch[worker], nImages);
+
+        for (unsigned int b = 0; b < nImages; ++b) {
+            DSmatrixComplex coeffsImage(m_rows, m_cols, batch[worker]->data() + b * size);
+            DSmatrixComplex imageComplex(m_rows, m_cols, imagesComplex[worker]->data() + b * size);
+            m_fftOp->convFF2F(coeffsImage, *m_shearlets[i], activeSupport(i), *matConv[worker]);
+            accumulate(imageComplex, *matConv[worker]);
+        }
+    };
+
+    if (m_pool == nullptr) {
+        for (unsigned int i = 0; i < m_shearlets.size(); ++i)
+            recoverShearlet(i, 0);
+    } else {
+        m_pool->parallelFor(m_shearlets.size(), recoverShearlet);
+    }
+
+    for (unsigned int w = 1; w < nWorkers; ++w)
+        accumulate(*imagesComplex[0], *imagesComplex[w]);
+
+    for (unsigned int b = 0; b < nImages; ++b) {
+        DSmatrixComplex imageComplex(m_rows, m_cols, imagesComplex[0]->data() + b * size);
+        normalize(imageComplex);
+    }
+    inverseFFTBatch(*serialFFTOp(), *imagesComplex[0], nImages);
+
+    for (unsigned int b = 0; b < nImages; ++b) {
+        DSmatrixComplex imageComplex(m_rows, m_cols, imagesComplex[0]->data() + b * size);
+        results.emplace_back(m_rows, m_cols);
+        InstrScope scope(m_instr, INSTR_COMPLEX2REAL, size * (sizeof(T) + sizeof(complex_type)));
+        complex2real(imageComplex, results.back());
+    }
+
+    for (unsigned int w = 0; w < nWorkers; ++w) {
+        delete batch[w];
+        delete matConv[w];
+        delete imagesComplex[w];
+    }
+
+    return results;
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::setNumThreads(unsigned int nThreads) {
+
+    delete m_pool;
+    delete m_fftOpThreaded;
+    m_pool = nullptr;
+    m_fftOpThreaded = nullptr;
+
+    // the shearlet loops run on the pool with single-threaded plans, the
+    // transforms in between use threaded plans: the two never overlap
+    if (nThreads > 1) {
+        m_pool = new ThreadPool(nThreads);
+        m_fftOpThreaded = new FourierTransform<T, backend>(m_rows, m_cols, m_rigor, nThreads);
+        m_fftOpThreaded->setInstrumentation(m_instr);
+    }
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::setShiftFree(bool enable) {
+
+    m_shiftFree = enable;
+    if (!enable || m_weightsUnshifted != nullptr)
+        return;
+
+    // ifftshift moves the centered index k to (k + ceil(n / 2)) mod n
+    m_supportsUnshifted.clear();
+    for (const t_box& box : m_supports) {
+        t_box moved = box;
+        moved.row = (box.row + m_rows - m_rows / 2) % m_rows;
+        moved.col = (box.col + m_cols - m_cols / 2) % m_cols;
+        m_supportsUnshifted.push_back(moved);
+    }
+
+    m_weightsUnshifted = new DSmatrixReal(*m_weights);
+    m_fftOp->ifftshift(*m_weightsUnshifted);
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::setInstrumentation(Instrumentation * instr) {
+
+    m_instr = instr;
+    m_fftOp->setInstrumentation(instr);
+    if (m_fftOpThreaded != nullptr)
+        m_fftOpThreaded->setInstrumentation(instr);
+}
+
+// Without shifts the frequency domain products are unchanged up to a
+// permutation, and the shifts around the inverse FFT undo those around
+// the forward one, so the bare transforms give the same data
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::forwardFFT(FourierTransform<T, backend>& op, DSmatrixComplex& mat) const {
+
+    if (m_shiftFree)
+        op.fft(mat);
+    else
+        op.fftWithShifts(mat);
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::inverseFFT(FourierTransform<T, backend>& op, DSmatrixComplex& mat) const {
+
+    if (m_shiftFree)
+        op.ifft(mat);
+    else
+        op.ifftWithShifts(mat);
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::forwardFFTBatch(FourierTransform<T, backend>& op, DSmatrixComplex& mat, unsigned int howmany) const {
+
+    if (m_shiftFree)
+        op.fftBatch(mat, howmany);
+    else
+        op.fftWithShiftsBatch(mat, howmany);
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::inverseFFTBatch(FourierTransform<T, backend>& op, DSmatrixComplex& mat, unsigned int howmany) const {
+
+    if (m_shiftFree)
+        op.ifftBatch(mat, howmany);
+    else
+        op.ifftWithShiftsBatch(mat, howmany);
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::forwardRFFT(FourierTransform<T, backend>& op, const DSmatrixReal& image, DSmatrixComplex& spectrum) const {
+
+    if (m_shiftFree)
+        op.rfftFull(image, spectrum);
+    else
+        op.rfftWithShifts(image, spectrum);
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::inverseRFFT(FourierTransform<T, backend>& op, DSmatrixComplex& spectrum, DSmatrixReal& image) const {
+
+    if (m_shiftFree)
+        op.irfftFull(spectrum, image);
+    else
+        op.irfftWithShifts(spectrum, image);
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::analyze(FourierTransform<T, backend>& op, unsigned int i,
+                                   const DSmatrixComplex& spectrum, DSmatrixComplex& coeffs) const {
+
+    // box product, inverse transform and, unless shift-free, two shifts
+    InstrScope scope(m_instr, INSTR_ANALYZE,
+                     2 * m_shearlets[i]->size() * sizeof(complex_type) +
+                     (m_shiftFree ? 5 : 9) * spectrumBytes(), i);
+    op.corrFF2F(spectrum, *m_shearlets[i], activeSupport(i), coeffs);
+    inverseFFT(op, coeffs);
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::synthesize(FourierTransform<T, backend>& op, unsigned int i,
+                                      DSmatrixComplex& coeffs, DSmatrixComplex& contribution) const {
+
+    // forward transform, unless shift-free two shifts, and box product
+    InstrScope scope(m_instr, INSTR_SYNTHESIZE,
+                     2 * m_shearlets[i]->size() * sizeof(complex_type) +
+                     (m_shiftFree ? 3 : 7) * spectrumBytes(), i);
+    forwardFFT(op, coeffs);
+    op.convFF2F(coeffs, *m_shearlets[i], activeSupport(i), contribution);
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::accumulate(DSmatrixComplex& accumulator, const DSmatrixComplex& contribution) const {
+
+    InstrScope scope(m_instr, INSTR_ACCUMULATE, 3 * spectrumBytes());
+    accumulator += contribution;
+}
+
+template<typename T, template <class> class  backend>
+void SLsystem<T, backend>::normalize(DSmatrixComplex& spectrum) const {
+
+    InstrScope scope(m_instr, INSTR_NORMALIZE,
+                     2 * spectrumBytes() + std::size_t(m_rows) * m_cols * sizeof(T));
+    divComplexByReal(spectrum, activeWeights());
+}
+
 template<typename T, template <class> class  backend>
 DSmatrix<T, backend> SLsystem<T, backend>::recover(SLcoeffs<typename backend<T>::complex, backend> &coeffs) {
 
-    DSmatrixComplex imageComplex(m_rows, m_cols, 0);
+    DSmatrixComplex imageComplex(m_rows, m_cols, complex_type(0));
     DSmatrixComplex matConv(m_rows, m_cols);
 
     for (unsigned int i = 0; i < m_shearlets.size(); ++i) {
-        m_fftOp->convDF2F( *(coeffs.getElement(i)) , *m_shearlets[i] , matConv );
-        imageComplex +=  matConv;
+        synthesize(*serialFFTOp(), i, *(coeffs.getElement(i)), matConv);
+        accumulate(imageComplex, matConv);
     }
 
-    divComplexByReal(imageComplex, *m_weights);
+    normalize(imageComplex);
 
-    m_fftOp->ifftWithShifts(imageComplex);
     DSmatrixReal resultReal(m_rows, m_cols);
-    complex2real(imageComplex, resultReal);
+    inverseRFFT(*serialFFTOp(), imageComplex, resultReal);
 
     return resultReal;
 }
@@ -30,10 +30,14 @@
 #ifndef SLSYSTEM_HPP_
 #define SLSYSTEM_HPP_
 
+#include <utility>
 #include <vector>
 #include <deque>
 #include <map>
+#include <string>
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 
 #include "src/dataStructure/dataStruct.hpp"
 
@@ -43,16 +47,30 @@
 #endif
 
 #include "src/fourier/FourierTransform.hpp"
+#include "src/transform/ThresholdParams.hpp"
 
 #include "src/shearlet/SLfilter.hpp"
+#include "src/shearlet/SLbank.hpp"
+
+#include "src/utils/threadPool.hpp"
+#include "src/utils/instrumentation.hpp"
 
 template<typename Tdata, template <class> class  backend>
 class SLcoeffs {
 
 public:
 
+    using real_type = decltype(std::abs(Tdata()));
+
     SLcoeffs() {};
 
+    SLcoeffs(const SLcoeffs&) = delete;
+    SLcoeffs& operator=(const SLcoeffs&) = delete;
+
+    SLcoeffs(SLcoeffs&& other) : m_coeffs(std::move(other.m_coeffs)) {
+        other.m_coeffs.clear();
+    }
+
     ~SLcoeffs() {
         for (unsigned int i = 0; i < m_coeffs.size(); ++i)
             delete(m_coeffs[i]);
@@ -62,10 +80,25 @@ public:
         m_coeffs.push_back( new DSmatrix<Tdata, backend>( matIn ) );
     }
 
+    // takes over the buffer of matIn without copying
+    void addElement(DSmatrix<Tdata, backend>&& matIn) {
+        m_coeffs.push_back( new DSmatrix<Tdata, backend>( std::move(matIn) ) );
+    }
+
     DSmatrix<Tdata, backend> * getElement(unsigned int i) {
         return m_coeffs[i];
     }
 
+    unsigned int size() const {
+        return m_coeffs.size();
+    }
+
+    // append an uninitialised element to be filled in place
+    DSmatrix<Tdata, backend> * newElement(t_dims dims) {
+        m_coeffs.push_back( new DSmatrix<Tdata, backend>( dims ) );
+        return m_coeffs.back();
+    }
+
     void applyThreshold(std::vector<Tdata>& threshold) {
 
         assert(threshold.size() == m_coeffs.size());
@@ -77,6 +110,41 @@ public:
         }
     }
 
+    // Shrink the coefficients of shearlet i by thresholds[i] with rule (firm
+    // shrinkage keeps those above firmRatio * thresholds[i]). All the
+    // buffers are processed in one pass of fixed-size blocks, split over
+    // pool when given
+    void shrink(const std::vector<real_type>& thresholds ,
+                ThresholdRule                 rule       ,
+                ThreadPool *                  pool       = nullptr,
+                real_type                     firmRatio  = real_type(2)) {
+
+        assert(thresholds.size() == m_coeffs.size());
+        assert(rule != THRESHOLD_FIRM || firmRatio > real_type(1));
+
+        // (shearlet, offset) of each block
+        std::vector<std::pair<unsigned int, unsigned int>> blocks;
+        for (unsigned int i = 0; i < m_coeffs.size(); ++i)
+            for (unsigned int offset = 0; offset < m_coeffs[i]->size(); offset += s_shrinkBlock)
+                blocks.emplace_back(i, offset);
+
+        auto shrinkBlock = [&](unsigned int b, unsigned int) {
+            unsigned int i = blocks[b].first;
+            unsigned int offset = blocks[b].second;
+            DSmatrix<Tdata, backend>* mat = m_coeffs[i];
+            unsigned int length = std::min(s_shrinkBlock, mat->size() - offset);
+            backend<Tdata>::op::shrink(mat->data() + offset, length, rule,
+                                       Tdata(thresholds[i]), Tdata(firmRatio * thresholds[i]));
+        };
+
+        if (pool == nullptr) {
+            for (unsigned int b = 0; b < blocks.size(); ++b)
+                shrinkBlock(b, 0);
+        } else {
+            pool->parallelFor(blocks.size(), shrinkBlock);
+        }
+    }
+
     void muteShearlet(unsigned int i) {
 
         assert(i < m_coeffs.size());
@@ -86,6 +154,9 @@ public:
     }
 
 private:
+    // elements per block of shrink
+    static constexpr unsigned int s_shrinkBlock = 1 << 15;
+
     std::vector<DSmatrix<Tdata, backend>*> m_coeffs;
 };
 
@@ -112,6 +183,7 @@ private:
         std::vector<DSmatrix<complex_type, backend>*> bandpass;
         std::vector<t_FilterDirections*> wedge;
         DSmatrix<complex_type, backend>* lowpass;
+        FourierTransform<T, backend> * op;        // of the cone size
     };
 
     struct t_Filters {
@@ -120,36 +192,218 @@ private:
         t_FiltersWedgeBandLow * cone2;
     };
 
-    t_FiltersWedgeBandLow * computeFilters(unsigned int nrows,
-                                           unsigned int ncols,
-                                           std::vector<int>& shearLevels);
+    // one shear level of one cone: the data shared by its directions
+    struct t_LevelPlan {
+        t_dims dims;                              // of the cone
+        int shearLevel;
+        t_FilterDirections * directions;
+        FourierTransform<T, backend> * coneOp;    // of the cone size
+        FourierTransform<T, backend> * op;        // upsampled size
+        DSmatrixComplex * wedgeConv;
+        DSmatrixComplex * lowpassSpectrum;        // of the flipped lowpass helper
+        std::vector<double> seconds;              // per task, when instrumented
+    };
+
+    // per-worker buffers of filterDirection, sized for the last level run
+    struct t_DirectionScratch {
+        t_dims dims = {0, 0};
+        DSmatrixComplex * sheared = nullptr;
+        DSmatrixComplex * conv = nullptr;
+    };
+
+    // filters of all the cones (coneDims[c] is the size of cone c) as a
+    // task graph on pool: the bandpass and lowpass filters and the shear
+    // levels, then the directions of every level
+    void computeFilters(const std::vector<t_dims>& coneDims,
+                        std::vector<int>& shearLevels,
+                        std::vector<t_FiltersWedgeBandLow*>& cones,
+                        ThreadPool& pool);
+
+    void prepareLevel(t_LevelPlan& plan,
+                      const DSmatrixReal& directionalFilter,
+                      const std::vector<DSmatrixReal*>& filterLow2);
+
+    void filterDirection(t_LevelPlan& plan, int k, t_DirectionScratch& scratch);
 
     t_Filters * prepareFilters(unsigned int nrows,
                                unsigned int ncols,
-                               std::vector<int>& shearLevels);
+                               std::vector<int>& shearLevels,
+                               ThreadPool& pool);
+
+    std::vector<int> computeIdxs(std::vector<int>& shearLevels) const;
 
-    std::vector<int> computeIdxs(std::vector<int>& shearLevels);
+    std::vector<int> computeShearLevels() const;
+
+    // shearlets of the finest scale of cone 1, whose coefficients are real
+    // for a real image
+    std::vector<unsigned int> finestShearlets() const;
+
+    // median absolute deviation estimate of sigma from the shearlets
+    // finest[j], streamed twice: coefficients(j, worker) returns the
+    // coefficients of finest[j], valid until the next call by that worker
+    template<typename Tsource>
+    T noiseFromShearlets(const std::vector<unsigned int>& finest, const Tsource& coefficients);
+
+    // nThreads builds the filters and shearlets, 0 for all the cores
+    void build(unsigned int rows,
+               unsigned int cols,
+               unsigned int nThreads);
+
+    t_SLbankKey bankKey() const;
+
+    void load(SLbank * bank);
+
+    static constexpr SLFilterType s_directionalFilter = SL_DIRECTIONAL1;
+    static constexpr SLFilterType s_scalingFilter     = SL_SCALING;
+    // relative magnitude below which a shearlet spectrum is treated as zero
+    static constexpr T s_supportTolerance = T(1e-4);
 
     unsigned int m_rows;
     unsigned int m_cols;
+    unsigned int m_nscales;
+    FFTRigor m_rigor;
     FourierTransform<T, backend> * m_fftOp;
+    // each shearlet is stored on the box m_supports[i] only
     std::vector<DSmatrixComplex*> m_shearlets;
+    std::vector<t_box> m_supports;
     DSmatrixReal * m_weights;
     std::map<int, unsigned int> m_shearlevel2index;
+    SLbank * m_bank;
+    ThreadPool * m_pool;
+    // same transform with threaded plans, used outside the shearlet loops
+    FourierTransform<T, backend> * m_fftOpThreaded;
+    Instrumentation * m_instr;
+
+    FourierTransform<T, backend> * serialFFTOp() const {
+        return m_fftOpThreaded != nullptr ? m_fftOpThreaded : m_fftOp;
+    }
+
+    // shift-free mode: the spectra are used in unshifted frequency order,
+    // so every transform is a bare FFT. Same shearlet data, with the boxes
+    // moved (and wrapping around the edges) and the weights ifftshifted
+    bool m_shiftFree;
+    std::vector<t_box> m_supportsUnshifted;
+    DSmatrixReal * m_weightsUnshifted;
+
+    // supports and weights in the active frequency order
+    const t_box& activeSupport(unsigned int i) const {
+        return m_shiftFree ? m_supportsUnshifted[i] : m_supports[i];
+    }
+
+    DSmatrixReal& activeWeights() const {
+        return m_shiftFree ? *m_weightsUnshifted : *m_weights;
+    }
+
+    // transforms between data and the active frequency order
+    void forwardFFT(FourierTransform<T, backend>& op, DSmatrixComplex& mat) const;
+    void inverseFFT(FourierTransform<T, backend>& op, DSmatrixComplex& mat) const;
+    void forwardFFTBatch(FourierTransform<T, backend>& op, DSmatrixComplex& mat, unsigned int howmany) const;
+    void inverseFFTBatch(FourierTransform<T, backend>& op, DSmatrixComplex& mat, unsigned int howmany) const;
+    void forwardRFFT(FourierTransform<T, backend>& op, const DSmatrixReal& image, DSmatrixComplex& spectrum) const;
+    // spectrum is overwritten
+    void inverseRFFT(FourierTransform<T, backend>& op, DSmatrixComplex& spectrum, DSmatrixReal& image) const;
+
+    // coefficients of shearlet i from the image spectrum
+    void analyze(FourierTransform<T, backend>& op, unsigned int i,
+                 const DSmatrixComplex& spectrum, DSmatrixComplex& coeffs) const;
+    // spectrum contribution of shearlet i; coeffs is overwritten
+    void synthesize(FourierTransform<T, backend>& op, unsigned int i,
+                    DSmatrixComplex& coeffs, DSmatrixComplex& contribution) const;
+
+    // accumulator += contribution
+    void accumulate(DSmatrixComplex& accumulator, const DSmatrixComplex& contribution) const;
+    // division by the dual frame weights
+    void normalize(DSmatrixComplex& spectrum) const;
+
+    std::size_t spectrumBytes() const {
+        return std::size_t(m_rows) * m_cols * sizeof(complex_type);
+    }
 
 public:
 
-    SLsystem(unsigned int rows,
-             unsigned int cols,
-             unsigned int Nscales);
+    // rigor is the planner rigor of the Fourier transforms; instr, if
+    // given, also receives the construction of the filters, which runs on
+    // buildThreads threads (0, the default, uses all the cores)
+    SLsystem(unsigned int      rows,
+             unsigned int      cols,
+             unsigned int      Nscales,
+             FFTRigor          rigor = FFT_ESTIMATE,
+             Instrumentation * instr = nullptr,
+             unsigned int      buildThreads = 0);
+
+    // Load the shearlet bank from fileName when its key matches,
+    // otherwise build the system and store it in fileName
+    SLsystem(unsigned int       rows    ,
+             unsigned int       cols    ,
+             unsigned int       Nscales ,
+             const std::string& fileName,
+             FFTRigor           rigor = FFT_ESTIMATE,
+             Instrumentation *  instr = nullptr,
+             unsigned int       buildThreads = 0);
 
     ~SLsystem();
 
     SLcoeffs<complex_type, backend> decode(DSmatrixReal &image);
 
     DSmatrixReal recover(SLcoeffs<complex_type, backend> &coeffs);
+
+    // Same as decode, SLcoeffs::applyThreshold and recover, streaming one
+    // shearlet at a time so that the coefficients are never all stored
+    DSmatrixReal denoise(DSmatrixReal &image, std::vector<complex_type>& thresholds);
+
+    // Same as decode, SLcoeffs::shrink and recover, streaming one shearlet
+    // at a time
+    DSmatrixReal denoise(DSmatrixReal            &image     ,
+                         const std::vector<T>&    thresholds,
+                         ThresholdRule            rule      ,
+                         T                        firmRatio = T(2));
+
+    // standard deviation of the coefficients of each shearlet for white
+    // noise of unit standard deviation in the image
+    std::vector<T> noiseLevels() const;
+
+    // thresholds for noise of standard deviation sigma: shearlet i gets
+    // factors[scale] * sigma * noiseLevels()[i] with one factor per scale
+    // (coarsest first; the lowpass shearlet gets 0), or factors[i] * sigma
+    // * noiseLevels()[i] with one factor per shearlet
+    std::vector<T> thresholds(T sigma, const std::vector<T>& factors) const;
+
+    // standard deviation of white noise in image from the median absolute
+    // value of the finest-scale coefficients of cone 1, normalized by
+    // noiseLevels(): only those shearlets are computed, twice each, one at
+    // a time per thread
+    T estimateNoise(DSmatrixReal &image);
+
+    // same from the coefficients returned by decode
+    T estimateNoise(SLcoeffs<complex_type, backend> &coeffs);
+
+    // thresholds(estimateNoise(image), factors)
+    std::vector<T> estimateThresholds(DSmatrixReal &image, const std::vector<T>& factors);
+
+    // Decode/recover a batch of images at once: the Fourier transforms run
+    // as batched plans and each shearlet is applied to the whole batch
+    std::vector<SLcoeffs<complex_type, backend>> decodeBatch(std::vector<DSmatrixReal>& images);
+
+    std::vector<DSmatrixReal> recoverBatch(std::vector<SLcoeffs<complex_type, backend>>& coeffs);
+
+    void save(const std::string& fileName);
+
+    // number of threads used by decode, recover, denoise and the batched
+    // methods (1 = serial): the shearlets are split over a thread pool and
+    // the remaining transforms use threaded FFT plans
+    void setNumThreads(unsigned int nThreads);
+
+    // shift-free mode (off by default): decode, recover, denoise and the
+    // batched methods skip every fftshift/ifftshift. The coefficients are
+    // the same in both modes
+    void setShiftFree(bool enable);
+
+    // per-stage timing of this system and of its Fourier transforms, not
+    // owned (nullptr, the default, disables it)
+    void setInstrumentation(Instrumentation * instr);
 };
 
 template class SLsystem<float, cpu_impl>;
+template class SLsystem<double, cpu_impl>;
 
 #endif
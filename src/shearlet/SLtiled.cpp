@@ -0,0 +1,313 @@
+/*
+ * @file SLtiled.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+
+#include "src/shearlet/SLtiled.hpp"
+#include "src/transform/transformMatrix.hpp"
+
+// true when the address ranges spanned by the two views intersect
+template<typename T, template <class> class  backend>
+static bool spansOverlap(const DSmatrixView<T, backend>& a, const DSmatrixView<T, backend>& b) {
+
+    auto span = [](const DSmatrixView<T, backend>& v) {
+        const T * first = v.data();
+        const T * last = v.data();
+        if (v.size() == 0)
+            return std::make_pair(first, last);
+        long int rowEnd = long(v.dims().rows - 1) * v.rowStride();
+        long int colEnd = long(v.dims().cols - 1) * v.colStride();
+        for (long int corner : {rowEnd, colEnd, rowEnd + colEnd}) {
+            const T * p = v.data() + corner;
+            first = std::min(first, p, std::less<const T*>());
+            last = std::max(last, p, std::less<const T*>());
+        }
+        return std::make_pair(first, last + 1);
+    };
+
+    auto spanA = span(a);
+    auto spanB = span(b);
+    std::less<const T*> less;
+    return less(spanA.first, spanB.second) && less(spanB.first, spanA.second);
+}
+
+// reflect the filled (rows x cols) corner of tile over its right and
+// bottom edges, without repeating the edge sample
+template<typename T, template <class> class  backend>
+static void mirrorPad(DSmatrix<T, backend>& tile, unsigned int rows, unsigned int cols) {
+
+    auto reflect = [](unsigned int k, unsigned int n) {
+        if (n == 1)
+            return 0U;
+        unsigned int period = 2 * n - 2;
+        k %= period;
+        return k < n ? k : period - k;
+    };
+
+    t_dims dims = tile.dims();
+    T * data = tile.data();
+    for (unsigned int i = 0; i < rows; ++i)
+        for (unsigned int j = cols; j < dims.cols; ++j)
+            data[i * dims.cols + j] = data[i * dims.cols + reflect(j, cols)];
+    for (unsigned int i = rows; i < dims.rows; ++i)
+        std::copy(data + reflect(i, rows) * dims.cols,
+                  data + (reflect(i, rows) + 1) * dims.cols,
+                  data + i * dims.cols);
+}
+
+template<typename T, template <class> class  backend>
+SLtiled<T, backend>::SLtiled(unsigned int tileRows,
+                             unsigned int tileCols,
+                             unsigned int overlap ,
+                             unsigned int Nscales ,
+                             FFTRigor     rigor   ) :
+m_tileRows(tileRows), m_tileCols(tileCols), m_overlap(overlap)
+{
+    // the two ramps of a window must not cross
+    assert(2 * overlap <= tileRows);
+    assert(2 * overlap <= tileCols);
+
+    m_system = new SLsystem<T, backend>(tileRows, tileCols, Nscales, rigor);
+}
+
+template<typename T, template <class> class  backend>
+SLtiled<T, backend>::~SLtiled() {
+
+    delete m_system;
+}
+
+template<typename T, template <class> class  backend>
+std::vector<unsigned int> SLtiled<T, backend>::origins(unsigned int n, unsigned int tile) const {
+
+    // the last tile is aligned with the end of the image
+    std::vector<unsigned int> first;
+    if (n <= tile) {
+        first.push_back(0);
+        return first;
+    }
+    unsigned int step = tile - m_overlap;
+    for (unsigned int s = 0; s + tile < n; s += step)
+        first.push_back(s);
+    first.push_back(n - tile);
+    return first;
+}
+
+template<typename T, template <class> class  backend>
+std::vector<T> SLtiled<T, backend>::window(unsigned int tile) const {
+
+    // sin^2 ramps: the ramps of two tiles one step apart sum to one
+    std::vector<T> w(tile, T(1));
+    for (unsigned int k = 0; k < m_overlap; ++k) {
+        T s = std::sin(T(M_PI) * (T(k) + T(0.5)) / T(2 * m_overlap));
+        w[k] = s * s;
+        w[tile - 1 - k] = s * s;
+    }
+    return w;
+}
+
+template<typename T, template <class> class  backend>
+void SLtiled<T, backend>::run(unsigned int          rows      ,
+                              unsigned int          cols      ,
+                              const TileRead&       read      ,
+                              const TileAccumulate& accumulate,
+                              const TileOp&         op        ) {
+
+    std::vector<unsigned int> rowOrigins = origins(rows, m_tileRows);
+    std::vector<unsigned int> colOrigins = origins(cols, m_tileCols);
+    std::vector<T> wRow = window(m_tileRows);
+    std::vector<T> wCol = window(m_tileCols);
+
+    // the windows are separable and so is the sum of those covering a pixel
+    std::vector<T> sumRow(rows, T(0));
+    std::vector<T> sumCol(cols, T(0));
+    for (unsigned int r0 : rowOrigins)
+        for (unsigned int i = 0; i < std::min(m_tileRows, rows - r0); ++i)
+            sumRow[r0 + i] += wRow[i];
+    for (unsigned int c0 : colOrigins)
+        for (unsigned int j = 0; j < std::min(m_tileCols, cols - c0); ++j)
+            sumCol[c0 + j] += wCol[j];
+
+    DSmatrixReal tile(m_tileRows, m_tileCols);
+    std::vector<T> fRow(m_tileRows);
+    std::vector<T> fCol(m_tileCols);
+    for (unsigned int r0 : rowOrigins) {
+
+        unsigned int nRows = std::min(m_tileRows, rows - r0);
+        for (unsigned int i = 0; i < nRows; ++i)
+            fRow[i] = wRow[i] / sumRow[r0 + i];
+
+        for (unsigned int c0 : colOrigins) {
+
+            unsigned int nCols = std::min(m_tileCols, cols - c0);
+            for (unsigned int j = 0; j < nCols; ++j)
+                fCol[j] = wCol[j] / sumCol[c0 + j];
+
+            read(r0, c0, nRows, nCols, tile);
+            mirrorPad(tile, nRows, nCols);
+
+            DSmatrixReal result = op(*m_system, tile);
+            assert(result.dims().rows == m_tileRows);
+            assert(result.dims().cols == m_tileCols);
+
+            T * data = result.data();
+            for (unsigned int i = 0; i < nRows; ++i)
+                for (unsigned int j = 0; j < nCols; ++j)
+                    data[i * m_tileCols + j] *= fRow[i] * fCol[j];
+
+            accumulate(r0, c0, nRows, nCols, result);
+        }
+    }
+}
+
+template<typename T, template <class> class  backend>
+void SLtiled<T, backend>::process(DSviewReal image, DSviewReal result, const TileOp& op) {
+
+    t_dims dims = image.dims();
+    assert(result.dims().rows == dims.rows);
+    assert(result.dims().cols == dims.cols);
+    // result is zeroed before the first tile is read
+    assert(!spansOverlap(image, result));
+
+    auto read = [&](unsigned int row, unsigned int col,
+                    unsigned int rows, unsigned int cols, DSmatrixReal& tile) {
+        copy(image.subview(t_box{row, col, rows, cols}),
+             tile.view(t_box{0, 0, rows, cols}));
+    };
+
+    auto accumulate = [&](unsigned int row, unsigned int col,
+                          unsigned int rows, unsigned int cols, const DSmatrixReal& tile) {
+        for (unsigned int i = 0; i < rows; ++i) {
+            T * dst = result.data() + long(row + i) * result.rowStride()
+                                    + long(col) * result.colStride();
+            const T * src = tile.data() + i * m_tileCols;
+            for (unsigned int j = 0; j < cols; ++j)
+                dst[j * result.colStride()] += src[j];
+        }
+    };
+
+    fill(result, T(0));
+    run(dims.rows, dims.cols, read, accumulate, op);
+}
+
+template<typename T, template <class> class  backend>
+void SLtiled<T, backend>::process(const std::string& imageFile ,
+                                  const std::string& resultFile,
+                                  unsigned int       rows      ,
+                                  unsigned int       cols      ,
+                                  const TileOp&      op        ) {
+
+    std::streamoff bytes = std::streamoff(rows) * cols * sizeof(T);
+
+    std::ifstream in(imageFile, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("SLtiled: cannot open " + imageFile);
+    in.seekg(0, std::ios::end);
+    if (in.tellg() < bytes)
+        throw std::runtime_error("SLtiled: " + imageFile + " is smaller than the image");
+
+    // zero-filled (sparse where supported) result, accumulated in place
+    {
+        std::ofstream create(resultFile, std::ios::binary | std::ios::trunc);
+        if (!create)
+            throw std::runtime_error("SLtiled: cannot open " + resultFile);
+        if (bytes > 0) {
+            create.seekp(bytes - 1);
+            create.put(0);
+        }
+        if (!create)
+            throw std::runtime_error("SLtiled: cannot write " + resultFile);
+    }
+    std::fstream out(resultFile, std::ios::binary | std::ios::in | std::ios::out);
+    if (!out)
+        throw std::runtime_error("SLtiled: cannot open " + resultFile);
+
+    auto position = [&](unsigned int row, unsigned int col) {
+        return (std::streamoff(row) * cols + col) * std::streamoff(sizeof(T));
+    };
+
+    auto read = [&](unsigned int row, unsigned int col,
+                    unsigned int nRows, unsigned int nCols, DSmatrixReal& tile) {
+        for (unsigned int i = 0; i < nRows; ++i) {
+            in.seekg(position(row + i, col));
+            in.read(reinterpret_cast<char*>(tile.data() + i * m_tileCols), nCols * sizeof(T));
+        }
+        if (!in)
+            throw std::runtime_error("SLtiled: cannot read " + imageFile);
+    };
+
+    std::vector<T> line(m_tileCols);
+    auto accumulate = [&](unsigned int row, unsigned int col,
+                          unsigned int nRows, unsigned int nCols, const DSmatrixReal& tile) {
+        for (unsigned int i = 0; i < nRows; ++i) {
+            out.seekg(position(row + i, col));
+            out.read(reinterpret_cast<char*>(line.data()), nCols * sizeof(T));
+            const T * src = tile.data() + i * m_tileCols;
+            for (unsigned int j = 0; j < nCols; ++j)
+                line[j] += src[j];
+            out.seekp(position(row + i, col));
+            out.write(reinterpret_cast<const char*>(line.data()), nCols * sizeof(T));
+        }
+        if (!out)
+            throw std::runtime_error("SLtiled: cannot write " + resultFile);
+    };
+
+    run(rows, cols, read, accumulate, op);
+}
+
+template<typename T, template <class> class  backend>
+void SLtiled<T, backend>::denoise(DSviewReal image, DSviewReal result,
+                                  std::vector<complex_type>& thresholds) {
+
+    process(image, result, [&](SLsystem<T, backend>& system, DSmatrixReal& tile) {
+        return system.denoise(tile, thresholds);
+    });
+}
+
+template<typename T, template <class> class  backend>
+void SLtiled<T, backend>::denoise(const std::string& imageFile ,
+                                  const std::string& resultFile,
+                                  unsigned int       rows      ,
+                                  unsigned int       cols      ,
+                                  std::vector<complex_type>& thresholds) {
+
+    process(imageFile, resultFile, rows, cols,
+            [&](SLsystem<T, backend>& system, DSmatrixReal& tile) {
+        return system.denoise(tile, thresholds);
+    });
+}
+
+// INSTANTIATION
+
+template class SLtiled<float, cpu_impl>;
+template class SLtiled<double, cpu_impl>;
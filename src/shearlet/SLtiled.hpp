@@ -0,0 +1,126 @@
+/*
+ * @file SLtiled.hpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SLTILED_HPP_
+#define SLTILED_HPP_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "src/dataStructure/dataStruct.hpp"
+
+#include "src/backend/cpu/backendCPU.hpp"
+#ifdef CUDA
+#include "src/backend/cuda/backendCUDA.hpp"
+#endif
+
+#include "src/shearlet/SLsystem.hpp"
+
+// Tiled processing of images larger than a shearlet system: the system is
+// built once for the tile size and every tile is processed independently.
+// Tiles overlap by `overlap` pixels and are blended back with a raised
+// cosine window normalized by the sum of the windows covering each pixel,
+// so an identity tile operation reproduces the image exactly. Border tiles
+// are shifted inwards; images smaller than a tile are mirror padded.
+template<typename T, template <class> class  backend>
+class SLtiled
+{
+
+public:
+
+    using complex_type = typename backend<T>::complex;
+    using DSmatrixReal = DSmatrix<T, backend>;
+    using DSviewReal = DSmatrixView<T, backend>;
+    // operation applied to each (tileRows x tileCols) tile
+    using TileOp = std::function<DSmatrixReal(SLsystem<T, backend>&, DSmatrixReal&)>;
+
+    SLtiled(unsigned int tileRows,
+            unsigned int tileCols,
+            unsigned int overlap ,
+            unsigned int Nscales ,
+            FFTRigor     rigor = FFT_ESTIMATE);
+
+    ~SLtiled();
+
+    SLtiled(const SLtiled&) = delete;
+    SLtiled& operator=(const SLtiled&) = delete;
+
+    // the underlying tile-sized system (threads, shift-free mode)
+    SLsystem<T, backend>& system() { return *m_system; }
+
+    // in memory: image and result are views of the same size whose
+    // address ranges must not overlap (result is zeroed before the first
+    // tile is read, so in-place calls are not supported)
+    void process(DSviewReal image, DSviewReal result, const TileOp& op);
+
+    // out of core: raw row-major files of T. Only one tile (plus one row
+    // of it) is held in memory; the result file is created or overwritten
+    void process(const std::string& imageFile ,
+                 const std::string& resultFile,
+                 unsigned int       rows      ,
+                 unsigned int       cols      ,
+                 const TileOp&      op        );
+
+    // SLsystem::denoise on every tile
+    void denoise(DSviewReal image, DSviewReal result,
+                 std::vector<complex_type>& thresholds);
+
+    void denoise(const std::string& imageFile ,
+                 const std::string& resultFile,
+                 unsigned int       rows      ,
+                 unsigned int       cols      ,
+                 std::vector<complex_type>& thresholds);
+
+private:
+
+    // read(row, col, rows, cols, tile) fills the top left corner of tile,
+    // accumulate(row, col, rows, cols, tile) adds it to the result
+    using TileRead = std::function<void(unsigned int, unsigned int,
+                                        unsigned int, unsigned int, DSmatrixReal&)>;
+    using TileAccumulate = std::function<void(unsigned int, unsigned int,
+                                              unsigned int, unsigned int, const DSmatrixReal&)>;
+
+    void run(unsigned int rows, unsigned int cols,
+             const TileRead& read, const TileAccumulate& accumulate,
+             const TileOp& op);
+
+    // first index of every tile along a dimension of size n
+    std::vector<unsigned int> origins(unsigned int n, unsigned int tile) const;
+    // blending window of a tile along a dimension
+    std::vector<T> window(unsigned int tile) const;
+
+    unsigned int m_tileRows;
+    unsigned int m_tileCols;
+    unsigned int m_overlap;
+
+    SLsystem<T, backend> * m_system;
+};
+
+#endif
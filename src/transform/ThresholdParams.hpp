@@ -0,0 +1,43 @@
+/*
+ * @file ThresholdParams.hpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef THRESHOLDPARAMS_HPP_
+#define THRESHOLDPARAMS_HPP_
+
+// Shrinkage of a coefficient c by a threshold t: c is multiplied by a gain
+// in [0, 1] that depends on |c| only, so the phase of complex data is kept.
+// Firm shrinkage has a second threshold t2 > t above which c is kept.
+enum ThresholdRule {
+    THRESHOLD_HARD,    // 1 if |c| >= t, 0 otherwise
+    THRESHOLD_SOFT,    // max(0, 1 - t / |c|)
+    THRESHOLD_GARROTE, // max(0, 1 - t^2 / |c|^2), non-negative garrote
+    THRESHOLD_FIRM     // min(1, max(0, t2 (|c| - t) / ((t2 - t) |c|)))
+};
+
+#endif
@@ -32,11 +32,14 @@
 
 #include <iostream>
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 #include <array>
 #include <vector>
 
 #include "src/dataStructure/dataStruct.hpp"
 #include "src/backend/cpu/backendCPU.hpp"
+#include "src/utils/threadPool.hpp"
 #ifdef CUDA
 #include "src/backend/cuda/backendCUDA.hpp"
 #endif
@@ -135,6 +138,162 @@ void pad(const DSmatrix<Tdata, backend>& inMat ,
                                    dims.rows, dims.cols);
 }
 
+template <typename Tdata, template <class> class  backend>
+void crop(const DSmatrix<Tdata, backend>& inMat ,
+          const t_box&                    box   ,
+                DSmatrix<Tdata, backend>& outMat) {
+
+    t_dims dims = inMat.dims();
+    t_dims dimsOut = outMat.dims();
+    assert(dimsOut.rows == box.rows);
+    assert(dimsOut.cols == box.cols);
+
+    Tdata * __restrict__ inData = inMat.data();
+    Tdata * __restrict__ outData = outMat.data();
+    backend<Tdata>::transform::crop(inData, outData,
+                                    box.row, box.col,
+                                    box.rows, box.cols,
+                                    dims.rows, dims.cols);
+}
+
+template <typename Tdata, template <class> class  backend>
+void embed(const DSmatrix<Tdata, backend>& inMat ,
+           const t_box&                    box   ,
+                 DSmatrix<Tdata, backend>& outMat) {
+
+    t_dims dims = inMat.dims();
+    t_dims dimsOut = outMat.dims();
+    assert(dims.rows == box.rows);
+    assert(dims.cols == box.cols);
+
+    Tdata * __restrict__ inData = inMat.data();
+    Tdata * __restrict__ outData = outMat.data();
+    backend<Tdata>::transform::embed(inData, outData,
+                                     box.row, box.col,
+                                     box.rows, box.cols,
+                                     dimsOut.rows, dimsOut.cols);
+}
+
+// strided views: same semantics as the DSmatrix versions above, but input
+// and output may be sub-images, tiles or subsamplings of larger buffers
+
+template <typename Tdata, template <class> class  backend>
+inline
+void copy(DSmatrixView<Tdata, backend> inView ,
+          DSmatrixView<Tdata, backend> outView) {
+
+    t_dims dims = inView.dims();
+    t_dims dimsOut = outView.dims();
+    assert(dims.rows == dimsOut.rows);
+    assert(dims.cols == dimsOut.cols);
+
+    backend<Tdata>::memory::copyStrided(outView.data(),
+                                        outView.rowStride(), outView.colStride(),
+                                        inView.data(),
+                                        inView.rowStride(), inView.colStride(),
+                                        dims.rows, dims.cols);
+}
+
+template <typename Tdata, template <class> class  backend>
+inline
+void fill(DSmatrixView<Tdata, backend> view ,
+          Tdata                        value) {
+
+    t_dims dims = view.dims();
+    backend<Tdata>::memory::fillStrided(view.data(),
+                                        view.rowStride(), view.colStride(),
+                                        dims.rows, dims.cols, value);
+}
+
+template <typename Tdata, template <class> class  backend>
+inline
+t_dims downsample(DSmatrixView<Tdata, backend> inView ,
+                  unsigned int                 dim    ,
+                  unsigned int                 stride ,
+                  DSmatrixView<Tdata, backend> outView) {
+
+    assert(dim == 0 || dim == 1);
+    if (dim == 0)
+        copy(inView.subsample(stride, 1), outView);
+    else
+        copy(inView.subsample(1, stride), outView);
+    return outView.dims();
+}
+
+template <typename Tdata, template <class> class  backend>
+inline
+t_dims upsample(DSmatrixView<Tdata, backend> inView ,
+                unsigned int                 dim    ,
+                unsigned int                 nzeros ,
+                DSmatrixView<Tdata, backend> outView) {
+
+    assert(dim == 0 || dim == 1);
+    fill(outView, Tdata(0));
+    if (dim == 0)
+        copy(inView, outView.subsample(nzeros + 1, 1));
+    else
+        copy(inView, outView.subsample(1, nzeros + 1));
+    return outView.dims();
+}
+
+template <typename Tdata, template <class> class  backend>
+inline
+void pad(DSmatrixView<Tdata, backend> inView ,
+         DSmatrixView<Tdata, backend> outView) {
+
+    t_dims dims = inView.dims();
+    t_dims dimsOut = outView.dims();
+    assert(dimsOut.rows >= dims.rows);
+    assert(dimsOut.cols >= dims.cols);
+
+    // same centring as the contiguous kernel
+    unsigned int offsetRows = ( dimsOut.rows - dims.rows ) / 2 + ( dimsOut.rows - dims.rows ) % 2;
+    unsigned int offsetCols = ( dimsOut.cols - dims.cols ) / 2 + ( dimsOut.cols - dims.cols ) % 2;
+    fill(outView, Tdata(0));
+    copy(inView, outView.subview(t_box{offsetRows, offsetCols, dims.rows, dims.cols}));
+}
+
+template <typename Tdata, template <class> class  backend>
+inline
+void crop(DSmatrixView<Tdata, backend> inView ,
+          const t_box&                 box    ,
+          DSmatrixView<Tdata, backend> outView) {
+
+    copy(inView.subview(box), outView);
+}
+
+template <typename Tdata, template <class> class  backend>
+inline
+void embed(DSmatrixView<Tdata, backend> inView ,
+           const t_box&                 box    ,
+           DSmatrixView<Tdata, backend> outView) {
+
+    fill(outView, Tdata(0));
+    copy(inView, outView.subview(box));
+}
+
+template <typename Tdata, template <class> class  backend>
+inline
+void transpose(DSmatrixView<Tdata, backend> inView ,
+               DSmatrixView<Tdata, backend> outView) {
+
+    copy(inView.transposed(), outView);
+}
+
+// bounding box of the entries whose magnitude exceeds tolerance times
+// the largest one
+template <typename Tdata, template <class> class  backend>
+t_box support(const DSmatrix<Tdata, backend>& inMat    ,
+                    Tdata                     tolerance) {
+
+    t_dims dims = inMat.dims();
+
+    unsigned int box[4];
+    backend<Tdata>::transform::support(inMat.data(), tolerance,
+                                       dims.rows, dims.cols, box);
+    return t_box{box[0], box[1], box[2], box[3]};
+}
+
 template <typename Tdata, template <class> class  backend>
 void dshear(const DSmatrix<Tdata, backend>& inMat ,
                   DSmatrix<Tdata, backend>& outMat,
@@ -149,19 +308,21 @@ template <typename Tdata, template <class> class  backend>
 void normL2(const DSmatrix<Tdata, backend>&  inMat,
                   Tdata                     *out  );
 
+// large products are split over pool when given
 template <typename Tdata, template <class> class  backend>
 inline
 void matMul(const DSmatrix<Tdata, backend>&  inMatL,
             const DSmatrix<Tdata, backend>&  inMatR,
-                  DSmatrix<Tdata, backend>&  outMat) {
+                  DSmatrix<Tdata, backend>&  outMat,
+                  ThreadPool *               pool = nullptr) {
 
     t_dims inMatLDims = inMatL.dims();
     t_dims inMatRDims = inMatR.dims();
     t_dims outMatDims = outMat.dims();
 
-    assert(inMatL.cols == inMatR.rows);
-    assert(inMatL.rows == outMat.rows);
-    assert(inMatR.cols == outMat.cols);
+    assert(inMatLDims.cols == inMatRDims.rows);
+    assert(inMatLDims.rows == outMatDims.rows);
+    assert(inMatRDims.cols == outMatDims.cols);
 
     backend<Tdata>::transform::matMul(inMatL.data(),
                                   inMatR.data(),
@@ -169,7 +330,8 @@ void matMul(const DSmatrix<Tdata, backend>&  inMatL,
                                   inMatLDims.rows,
                                   inMatLDims.cols,
                                   inMatRDims.rows,
-                                  inMatRDims.cols);
+                                  inMatRDims.cols,
+                                  pool);
 }
 
 // TODO: fix implementation for CUDA backend
@@ -206,6 +368,11 @@ struct reduceNmat_helper<float, cpu_impl> {
     using type = reduceNmat_impl<float, cpu_impl, cpu_complex_impl>;
 };
 
+template<>
+struct reduceNmat_helper<double, cpu_impl> {
+    using type = reduceNmat_impl<double, cpu_impl, cpu_complex_impl>;
+};
+
 template<typename Tdata, template <class> class  backend>
 using reduceNmatCaller = typename reduceNmat_helper<Tdata, backend>::type;
 
@@ -240,6 +407,11 @@ struct real2complex_helper<float, cpu_impl> {
     using type = real2complex_impl<float, cpu_impl, cpu_complex_impl>;
 };
 
+template<>
+struct real2complex_helper<double, cpu_impl> {
+    using type = real2complex_impl<double, cpu_impl, cpu_complex_impl>;
+};
+
 template<typename Tdata, template <class> class  backend>
 using real2complexCaller = typename real2complex_helper<Tdata, backend>::type;
 
@@ -273,6 +445,11 @@ struct complex2real_helper<float, cpu_impl> {
     using type = complex2real_impl<float, cpu_impl, cpu_complex_impl>;
 };
 
+template<>
+struct complex2real_helper<double, cpu_impl> {
+    using type = complex2real_impl<double, cpu_impl, cpu_complex_impl>;
+};
+
 template<typename Tdata, template <class> class  backend>
 using complex2realCaller = typename complex2real_helper<Tdata, backend>::type;
 
@@ -310,6 +487,11 @@ struct divComplexByReal_helper<float, cpu_impl> {
     using type = divComplexByReal_impl<float, cpu_impl, cpu_complex_impl>;
 };
 
+template<>
+struct divComplexByReal_helper<double, cpu_impl> {
+    using type = divComplexByReal_impl<double, cpu_impl, cpu_complex_impl>;
+};
+
 template<typename Tdata, template <class> class  backend>
 using divComplexByRealCaller = typename divComplexByReal_helper<Tdata, backend>::type;
 
@@ -321,13 +503,70 @@ void divComplexByReal( DSmatrix<typename backend<Tdata>::complex, backend>&  com
     return divComplexByRealCaller<Tdata, backend>::doit(complexMat, realMat);
 }
 
+// algorithm of convolve: CONV_AUTO picks the separable passes for rank
+// one filters and otherwise the cheaper of direct and FFT convolution
+enum ConvAlgorithm {
+    CONV_AUTO,
+    CONV_DIRECT,
+    CONV_SEPARABLE,
+    CONV_FFT
+};
+
 template <typename Tdata, template <class> class  backend,
-                          template <class> class  backendC>
+                          template <class> class  backendC,
+                          template <class> class  backendF>
 struct convolve_impl {
 
-    static t_dims doit(const DSmatrix<Tdata, backend>&  inMat ,
-                       const DSmatrix<Tdata, backend>&  filter,
-                             DSmatrix<Tdata, backend>*  outMat) {
+    using complex_type = typename backend<Tdata>::complex;
+
+    // multiply-adds per output sample and log2 of the transform size that
+    // an FFT convolution costs (three real transforms and a product)
+    static constexpr double s_fftCost = 8.0;
+
+    static ConvAlgorithm select(t_dims inDims, t_dims fDims, t_dims outDims) {
+
+        double direct = double(inDims.rows) * inDims.cols * fDims.rows * fDims.cols;
+        double size = double(outDims.rows) * outDims.cols;
+        double fft = s_fftCost * size * std::log2(std::max(size, 2.0));
+        return direct <= fft ? CONV_DIRECT : CONV_FFT;
+    }
+
+    static void fftConvolve(const DSmatrix<Tdata, backend>&  inMat ,
+                            const DSmatrix<Tdata, backend>&  filter,
+                                  DSmatrix<Tdata, backend>&  outMat) {
+
+        t_dims inDims  = inMat.dims();
+        t_dims fDims   = filter.dims();
+        t_dims outDims = outMat.dims();
+
+        // zero padding to the full output size makes the circular
+        // convolution of the transforms a linear one
+        DSmatrix<Tdata, backend> inPadded(outDims);
+        backendC<Tdata>::op::padMatrix(inMat.data(), inPadded.data(),
+                                       inDims.rows, inDims.cols,
+                                       outDims.rows, outDims.cols);
+        DSmatrix<Tdata, backend> filterPadded(outDims);
+        backendC<Tdata>::op::padMatrix(filter.data(), filterPadded.data(),
+                                       fDims.rows, fDims.cols,
+                                       outDims.rows, outDims.cols);
+
+        auto fourier = backendF<Tdata>::fourier::instance(outDims.rows, outDims.cols);
+        unsigned int halfCols = outDims.cols / 2 + 1;
+        DSmatrix<complex_type, backend> inHat(outDims.rows, halfCols);
+        DSmatrix<complex_type, backend> filterHat(outDims.rows, halfCols);
+        DSmatrix<complex_type, backend> product(outDims.rows, halfCols);
+        fourier->rfft(inPadded.data(), inHat.data());
+        fourier->rfft(filterPadded.data(), filterHat.data());
+        backendC<Tdata>::op::convComplex(inHat.data(), filterHat.data(),
+                                         product.data(), product.size());
+        fourier->irfft(product.data(), outMat.data());
+        outMat.normSize();
+    }
+
+    static t_dims doit(const DSmatrix<Tdata, backend>&  inMat    ,
+                       const DSmatrix<Tdata, backend>&  filter   ,
+                             DSmatrix<Tdata, backend>*  outMat   ,
+                             ConvAlgorithm              algorithm) {
 
         t_dims inDims  = inMat.dims();
         t_dims fDims   = filter.dims();
@@ -341,29 +580,45 @@ struct convolve_impl {
         assert(outDims.rows == inDims.rows + fDims.rows - 1);
         assert(outDims.cols == inDims.cols + fDims.cols - 1);
 
-        DSmatrix<Tdata, backend> inMatPadded(outDims.rows, outDims.cols);
-        backendC<Tdata>::op::padMatrix(inMat.data(),
-                                    inMatPadded.data(),
-                                    inDims.rows,
-                                    inDims.cols,
-                                    outDims.rows,
-                                    outDims.cols);
-
-        DSmatrix<Tdata, backend> filterPadded(outDims.rows, outDims.cols);
-        backendC<Tdata>::op::padMatrix(filter.data(),
-                                    filterPadded.data(),
-                                    fDims.rows,
-                                    fDims.cols,
-                                    outDims.rows,
-                                    outDims.cols);
-
-        backendC<Tdata>::op::convData(inMatPadded.data(),
-                                    filterPadded.data(),
-                                    outMat->data(),
-                                    inDims.rows,
-                                    inDims.cols,
-                                    fDims.rows,
-                                    fDims.cols);
+        if (algorithm == CONV_AUTO || algorithm == CONV_SEPARABLE) {
+
+            DSmatrix<Tdata, backend> colFilter(fDims.rows, 1);
+            DSmatrix<Tdata, backend> rowFilter(1, fDims.cols);
+            bool rankOne = backendC<Tdata>::op::separable(filter.data(),
+                                                          colFilter.data(),
+                                                          rowFilter.data(),
+                                                          fDims.rows,
+                                                          fDims.cols);
+            if (rankOne) {
+                backendC<Tdata>::op::convSeparable(inMat.data(),
+                                                   colFilter.data(),
+                                                   rowFilter.data(),
+                                                   outMat->data(),
+                                                   inDims.rows,
+                                                   inDims.cols,
+                                                   fDims.rows,
+                                                   fDims.cols);
+                return outDims;
+            }
+            // a full rank filter cannot be split
+            algorithm = CONV_AUTO;
+        }
+
+        if (algorithm == CONV_AUTO)
+            algorithm = select(inDims, fDims, outDims);
+
+        if (algorithm == CONV_FFT) {
+            fftConvolve(inMat, filter, *outMat);
+            return outDims;
+        }
+
+        backendC<Tdata>::op::convData(inMat.data(),
+                                      filter.data(),
+                                      outMat->data(),
+                                      inDims.rows,
+                                      inDims.cols,
+                                      fDims.rows,
+                                      fDims.cols);
         return outDims;
     }
 };
@@ -372,19 +627,26 @@ template<typename T, template <class> class  backend> struct convolve_helper;
 
 template<>
 struct convolve_helper<float, cpu_impl> {
-    using type = convolve_impl<float, cpu_impl, cpu_complex_impl>;
+    using type = convolve_impl<float, cpu_impl, cpu_complex_impl, cpu_fft_impl>;
+};
+
+template<>
+struct convolve_helper<double, cpu_impl> {
+    using type = convolve_impl<double, cpu_impl, cpu_complex_impl, cpu_fft_impl>;
 };
 
 template<typename Tdata, template <class> class  backend>
 using convolveCaller = typename convolve_helper<Tdata, backend>::type;
 
+// full linear convolution, (rows + fRows - 1) x (cols + fCols - 1)
 template<typename Tdata, template <class> class  backend>
 inline
 t_dims convolve(const DSmatrix<Tdata, backend>&  inMat ,
                 const DSmatrix<Tdata, backend>&  filter,
-                      DSmatrix<Tdata, backend>*  outMat = nullptr) {
+                      DSmatrix<Tdata, backend>*  outMat = nullptr,
+                      ConvAlgorithm              algorithm = CONV_AUTO) {
 
-    return convolveCaller<Tdata, backend>::doit(inMat, filter, outMat);
+    return convolveCaller<Tdata, backend>::doit(inMat, filter, outMat, algorithm);
 }
 
 #endif
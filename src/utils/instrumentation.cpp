@@ -0,0 +1,88 @@
+/*
+ * @file instrumentation.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cmath>
+#include <utility>
+
+#include "src/utils/instrumentation.hpp"
+
+Instrumentation::Instrumentation(callback_type callback)
+: m_callback(std::move(callback))
+{
+    reset();
+}
+
+void Instrumentation::record(InstrStage stage, int index, double seconds, std::size_t bytes) {
+
+    m_calls[stage].fetch_add(1, std::memory_order_relaxed);
+    m_nanoseconds[stage].fetch_add(std::llround(seconds * 1e9), std::memory_order_relaxed);
+    m_bytes[stage].fetch_add(bytes, std::memory_order_relaxed);
+
+    if (m_callback)
+        m_callback(t_instrEvent{stage, index, seconds, bytes});
+}
+
+t_instrStats Instrumentation::stats(InstrStage stage) const {
+
+    t_instrStats result;
+    result.calls   = m_calls[stage].load(std::memory_order_relaxed);
+    result.seconds = m_nanoseconds[stage].load(std::memory_order_relaxed) * 1e-9;
+    result.bytes   = m_bytes[stage].load(std::memory_order_relaxed);
+    return result;
+}
+
+void Instrumentation::reset() {
+
+    for (unsigned int s = 0; s < INSTR_NSTAGES; ++s) {
+        m_calls[s].store(0, std::memory_order_relaxed);
+        m_nanoseconds[s].store(0, std::memory_order_relaxed);
+        m_bytes[s].store(0, std::memory_order_relaxed);
+    }
+}
+
+const char * Instrumentation::stageName(InstrStage stage) {
+
+    switch (stage) {
+        case INSTR_RFFT:         return "rfft";
+        case INSTR_FFT:          return "fft";
+        case INSTR_IFFT:         return "ifft";
+        case INSTR_IRFFT:        return "irfft";
+        case INSTR_SHIFT:        return "shift";
+        case INSTR_CORRELATE:    return "correlate";
+        case INSTR_CONVOLVE:     return "convolve";
+        case INSTR_REAL2COMPLEX: return "real2complex";
+        case INSTR_COMPLEX2REAL: return "complex2real";
+        case INSTR_ANALYZE:      return "analyze";
+        case INSTR_SYNTHESIZE:   return "synthesize";
+        case INSTR_ACCUMULATE:   return "accumulate";
+        case INSTR_NORMALIZE:    return "normalize";
+        case INSTR_FILTERS:      return "filters";
+        default:                 return "unknown";
+    }
+}
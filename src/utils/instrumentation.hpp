@@ -0,0 +1,132 @@
+/*
+ * @file instrumentation.hpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef INSTRUMENTATION_HPP_
+#define INSTRUMENTATION_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+// Stages reported by FourierTransformImpl and SLsystem. INSTR_ANALYZE and
+// INSTR_SYNTHESIZE, reported by decode, recover and denoise, include the
+// transform stages they run, and so does INSTR_FILTERS; the other stages
+// do not overlap.
+enum InstrStage {
+    INSTR_RFFT,            // real to complex forward transforms
+    INSTR_FFT,             // complex forward transforms
+    INSTR_IFFT,            // complex inverse transforms, normalization included
+    INSTR_IRFFT,           // complex to real inverse transforms, same
+    INSTR_SHIFT,           // fftshift and ifftshift
+    INSTR_CORRELATE,       // corrFF2F
+    INSTR_CONVOLVE,        // convFF2F
+    INSTR_REAL2COMPLEX,
+    INSTR_COMPLEX2REAL,
+    INSTR_ANALYZE,         // corrFF2D of one shearlet (index = shearlet)
+    INSTR_SYNTHESIZE,      // convDF2F of one shearlet (index = shearlet)
+    INSTR_ACCUMULATE,      // sum of the shearlet contributions
+    INSTR_NORMALIZE,       // divComplexByReal by the dual frame weights
+    INSTR_FILTERS,         // filters of one shear level of a cone (index = level),
+                           // time summed over the workers
+    INSTR_NSTAGES
+};
+
+struct t_instrEvent {
+    InstrStage  stage;
+    int         index;     // -1 when the stage has no index
+    double      seconds;
+    std::size_t bytes;     // bytes read plus bytes written, estimated
+};
+
+struct t_instrStats {
+    unsigned long long calls;
+    double             seconds;
+    unsigned long long bytes;
+};
+
+// Per-stage wall time, call count and bytes touched. The totals are
+// updated atomically, so one Instrumentation can be shared by all the
+// workers of a pool; the callback, if any, receives every event and is
+// called concurrently from those workers.
+class Instrumentation
+{
+public:
+    using callback_type = std::function<void(const t_instrEvent&)>;
+
+    Instrumentation(callback_type callback = callback_type());
+
+    Instrumentation(const Instrumentation&) = delete;
+    Instrumentation& operator=(const Instrumentation&) = delete;
+
+    void record(InstrStage stage, int index, double seconds, std::size_t bytes);
+
+    t_instrStats stats(InstrStage stage) const;
+
+    void reset();
+
+    static const char * stageName(InstrStage stage);
+
+private:
+    callback_type m_callback;
+    std::atomic<unsigned long long> m_calls[INSTR_NSTAGES];
+    std::atomic<unsigned long long> m_nanoseconds[INSTR_NSTAGES];
+    std::atomic<unsigned long long> m_bytes[INSTR_NSTAGES];
+};
+
+// Times its own scope. With a null Instrumentation it does not read the
+// clock, so a disabled probe costs a single branch.
+class InstrScope
+{
+public:
+    InstrScope(Instrumentation * instr, InstrStage stage, std::size_t bytes, int index = -1)
+     : m_instr(instr), m_stage(stage), m_index(index), m_bytes(bytes) {
+        if (m_instr != nullptr)
+            m_start = std::chrono::steady_clock::now();
+    }
+
+    ~InstrScope() {
+        if (m_instr != nullptr) {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start;
+            m_instr->record(m_stage, m_index, elapsed.count(), m_bytes);
+        }
+    }
+
+    InstrScope(const InstrScope&) = delete;
+    InstrScope& operator=(const InstrScope&) = delete;
+
+private:
+    Instrumentation * m_instr;
+    InstrStage m_stage;
+    int m_index;
+    std::size_t m_bytes;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif
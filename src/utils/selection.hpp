@@ -0,0 +1,126 @@
+/*
+ * @file selection.hpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SELECTION_HPP_
+#define SELECTION_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cassert>
+
+// k-th smallest (0-based) of a stream of non-negative values that can be
+// read twice, in linear time and without storing it: the first pass counts
+// the values on fixed logarithmic bins (so their range need not be known),
+// the second keeps only the values of the bin holding rank k, which are
+// selected with nth_element. Each pass can be split over workers, each
+// passing its own index to count and collect
+template <typename T>
+class RankSelector
+{
+public:
+    RankSelector(std::size_t k, unsigned int nWorkers) :
+    m_k(k), m_counts(nWorkers, std::vector<std::size_t>(s_nBins, 0)),
+    m_candidates(nWorkers), m_bin(0), m_below(0) {}
+
+    // first pass
+    void count(const T * values, std::size_t n, unsigned int worker) {
+
+        std::vector<std::size_t>& counts = m_counts[worker];
+        for (std::size_t i = 0; i < n; ++i)
+            ++counts[binOf(values[i])];
+    }
+
+    // between the passes: false when the stream holds k values or fewer
+    bool locate() {
+
+        for (std::size_t w = 1; w < m_counts.size(); ++w)
+            for (unsigned int b = 0; b < s_nBins; ++b)
+                m_counts[0][b] += m_counts[w][b];
+
+        m_below = 0;
+        for (m_bin = 0; m_bin < s_nBins; ++m_bin) {
+            if (m_below + m_counts[0][m_bin] > m_k)
+                return true;
+            m_below += m_counts[0][m_bin];
+        }
+        return false;
+    }
+
+    // second pass, on the same values as the first one
+    void collect(const T * values, std::size_t n, unsigned int worker) {
+
+        std::vector<T>& candidates = m_candidates[worker];
+        for (std::size_t i = 0; i < n; ++i)
+            if (binOf(values[i]) == m_bin)
+                candidates.push_back(values[i]);
+    }
+
+    T select() {
+
+        std::vector<T>& inBin = m_candidates[0];
+        for (std::size_t w = 1; w < m_candidates.size(); ++w)
+            inBin.insert(inBin.end(), m_candidates[w].begin(), m_candidates[w].end());
+        assert(m_k - m_below < inBin.size());
+        std::nth_element(inBin.begin(), inBin.begin() + (m_k - m_below), inBin.end());
+        return inBin[m_k - m_below];
+    }
+
+private:
+    // s_subBins bins per octave of [2^s_minExponent, 2^s_maxExponent), one
+    // bin below (zero included) and one above, in increasing order
+    static constexpr int s_minExponent = -64;
+    static constexpr int s_maxExponent = 64;
+    static constexpr unsigned int s_subBins = 64;
+    static constexpr unsigned int s_nBins = (s_maxExponent - s_minExponent) * s_subBins + 2;
+
+    static unsigned int binOf(T value) {
+
+        assert(value >= T(0));
+        int exponent;
+        T mantissa = std::frexp(value, &exponent);
+        if (value == T(0) || exponent < s_minExponent)
+            return 0;
+        if (exponent >= s_maxExponent)
+            return s_nBins - 1;
+        // mantissa is in [0.5, 1)
+        unsigned int sub = std::min(s_subBins - 1,
+                                    static_cast<unsigned int>((mantissa - T(0.5)) * T(2 * s_subBins)));
+        return 1 + (exponent - s_minExponent) * s_subBins + sub;
+    }
+
+    std::size_t m_k;
+    std::vector<std::vector<std::size_t>> m_counts;
+    std::vector<std::vector<T>> m_candidates;
+    unsigned int m_bin;
+    std::size_t m_below;
+};
+
+#endif
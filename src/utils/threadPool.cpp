@@ -0,0 +1,132 @@
+/*
+ * @file threadPool.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "src/utils/threadPool.hpp"
+
+namespace {
+    // set while a thread executes pool tasks
+    thread_local bool t_inPool = false;
+}
+
+ThreadPool::ThreadPool(unsigned int nThreads)
+: m_task(nullptr),
+  m_nTasks(0),
+  m_next(0),
+  m_active(0),
+  m_generation(0),
+  m_stop(false)
+{
+    for (unsigned int i = 1; i < nThreads; ++i)
+        m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+unsigned int ThreadPool::size() const {
+
+    return m_threads.size() + 1;
+}
+
+void ThreadPool::parallelFor(unsigned int n, const task_type& task) {
+
+    if (n == 0)
+        return;
+
+    if (m_threads.empty() || n == 1 || t_inPool) {
+        for (unsigned int i = 0; i < n; ++i)
+            task(i, 0);
+        return;
+    }
+
+    // one job at a time
+    std::lock_guard<std::mutex> submit(m_submit);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_nTasks = n;
+        m_next = 0;
+        m_active = m_threads.size();
+        m_error = nullptr;
+        ++m_generation;
+    }
+    m_wakeUp.notify_all();
+
+    runTasks(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_active == 0; });
+    m_task = nullptr;
+    if (m_error)
+        std::rethrow_exception(m_error);
+}
+
+void ThreadPool::workerLoop(unsigned int worker) {
+
+    unsigned long generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [&] { return m_stop || m_generation != generation; });
+            if (m_stop)
+                return;
+            generation = m_generation;
+        }
+
+        runTasks(worker);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_active == 0)
+            m_done.notify_one();
+    }
+}
+
+void ThreadPool::runTasks(unsigned int worker) {
+
+    t_inPool = true;
+    unsigned int i;
+    while ((i = m_next.fetch_add(1)) < m_nTasks) {
+        try {
+            (*m_task)(i, worker);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error)
+                m_error = std::current_exception();
+        }
+    }
+    t_inPool = false;
+}
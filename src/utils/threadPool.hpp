@@ -0,0 +1,81 @@
+/*
+ * @file threadPool.hpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef THREADPOOL_HPP_
+#define THREADPOOL_HPP_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+
+// Fixed-size pool running one parallelFor at a time. The calling thread
+// takes part in the work as worker 0, so a pool of size N spawns N-1
+// threads. The worker index passed to the task is in [0, size()) and can
+// be used to select per-thread scratch buffers.
+class ThreadPool
+{
+public:
+    using task_type = std::function<void(unsigned int index, unsigned int worker)>;
+
+    ThreadPool(unsigned int nThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int size() const;
+
+    // run task(i, worker) for i in [0, n); nested calls from a worker run
+    // serially on the calling thread
+    void parallelFor(unsigned int n, const task_type& task);
+
+private:
+    void workerLoop(unsigned int worker);
+    void runTasks(unsigned int worker);
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_done;
+    std::mutex m_submit;
+
+    const task_type * m_task;
+    unsigned int m_nTasks;
+    std::atomic<unsigned int> m_next;
+    unsigned int m_active;
+    unsigned long m_generation;
+    bool m_stop;
+    std::exception_ptr m_error;
+};
+
+#endif
@@ -32,6 +32,7 @@
 
 #include "src/dataStructure/dataStruct.hpp"
 #include "src/backend/cpu/backendCPU.hpp"
+#include "src/backend/cpu/backendCPUpool.hpp"
 #ifdef CUDA
 #include "src/backend/cuda/backendCUDA.hpp"
 #endif
@@ -75,6 +76,73 @@ TYPED_TEST(DSmatrixTemplate, assign_CPU) {
     test_equality(myMatrix.data(), copyMatrix.data(), rows*cols);
 }
 
+TYPED_TEST(DSmatrixTemplate, move_CPU) {
+
+    set_seed();
+    unsigned int rows = 1024;
+    unsigned int cols =  512;
+    DSmatrix<TypeParam, cpu_impl> myMatrix(rows, cols);
+    generate_random_values(myMatrix.data(), rows*cols, TypeParam(-10.0), TypeParam(10.0));
+    DSmatrix<TypeParam, cpu_impl> reference(myMatrix);
+    TypeParam * data = myMatrix.data();
+
+    // move construction takes over the buffer
+    DSmatrix<TypeParam, cpu_impl> moved(std::move(myMatrix));
+    ASSERT_EQ(moved.data(), data);
+    ASSERT_TRUE(myMatrix.is_empty());
+
+    // move assignment releases the old buffer and takes over the new one
+    DSmatrix<TypeParam, cpu_impl> assigned(rows, cols);
+    assigned = std::move(moved);
+    ASSERT_EQ(assigned.data(), data);
+    ASSERT_TRUE(moved.is_empty());
+    test_equality(reference.data(), assigned.data(), rows*cols);
+
+    // copy assignment into an existing matrix copies the data
+    DSmatrix<TypeParam, cpu_impl> copied(1, 1);
+    copied = assigned;
+    ASSERT_NE(copied.data(), assigned.data());
+    ASSERT_EQ(copied.size(), rows*cols);
+    test_equality(reference.data(), copied.data(), rows*cols);
+}
+
+TYPED_TEST(DSmatrixTemplate, memoryPool_CPU) {
+
+    cpu::details::MemoryPool& pool = cpu::details::MemoryPool::instance();
+    pool.trim();
+
+    unsigned int rows = 300;
+    unsigned int cols = 301;
+    TypeParam * data;
+    {
+        DSmatrix<TypeParam, cpu_impl> myMatrix(rows, cols);
+        data = myMatrix.data();
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(data) % cpu::details::MemoryPool::s_alignment, 0u);
+        generate_random_values(data, rows*cols, TypeParam(-10.0), TypeParam(10.0));
+    }
+    ASSERT_GE(pool.cachedBytes(), rows*cols*sizeof(TypeParam));
+
+    // a block of the same size class is recycled
+    {
+        DSmatrix<TypeParam, cpu_impl> myMatrix(rows, cols - 1);
+        ASSERT_EQ(myMatrix.data(), data);
+        ASSERT_EQ(pool.cachedBytes(), 0u);
+    }
+
+    // small blocks and a zero capacity bypass the cache
+    {
+        DSmatrix<TypeParam, cpu_impl> small(4, 4);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(small.data()) % cpu::details::MemoryPool::s_alignment, 0u);
+    }
+    pool.setCapacity(0);
+    ASSERT_EQ(pool.cachedBytes(), 0u);
+    {
+        DSmatrix<TypeParam, cpu_impl> myMatrix(rows, cols);
+    }
+    ASSERT_EQ(pool.cachedBytes(), 0u);
+    pool.setCapacity(size_t(1) << 30);
+}
+
 TYPED_TEST(DSmatrixTemplate, plus_equal_CPU) {
 
     set_seed();
@@ -29,8 +29,12 @@
 
 #include <iostream>
 #include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
 
 #include "src/backend/cpu/backendCPU.hpp"
+#include "src/backend/cpu/backendCPUsimd.hpp"
 
 #ifdef CUDA
 #include "src/backend/cuda/backendCUDA.hpp"
@@ -43,6 +47,35 @@
 
 # define M_PI 3.14159265358979323846
 
+// every kernel available on this CPU against the std::complex products,
+// with sizes covering the vector tails
+template<typename T>
+void testComplexKernels(double tolerance) {
+
+    using namespace cpu::details;
+    for (int level = SIMD_SCALAR; level <= simdLevel(); ++level) {
+#if !defined(__aarch64__)
+        if (level == SIMD_NEON)
+            continue;
+#endif
+        complex_kernel<T> corr = corrKernel<T>(static_cast<SIMDLevel>(level));
+        complex_kernel<T> conv = convKernel<T>(static_cast<SIMDLevel>(level));
+        for (unsigned int size = 0; size < 40; ++size) {
+            std::vector<std::complex<T>> a(size), b(size), out(size);
+            generate_random_values(a.data(), size, T(-1.0), T(1.0));
+            generate_random_values(b.data(), size, T(-1.0), T(1.0));
+
+            corr(a.data(), b.data(), out.data(), size);
+            for (unsigned int i = 0; i < size; ++i)
+                ASSERT_NEAR(std::abs(out[i] - a[i] * std::conj(b[i])), 0.0, tolerance);
+
+            conv(a.data(), b.data(), out.data(), size);
+            for (unsigned int i = 0; i < size; ++i)
+                ASSERT_NEAR(std::abs(out[i] - a[i] * b[i]), 0.0, tolerance);
+        }
+    }
+}
+
 template<typename T>
 void fftshiftMatrixCPU(T * idata, T * odata,
                        unsigned int mRows, unsigned int mCols) {
@@ -228,6 +261,66 @@ TEST(fourier, ifftshift_CPU) {
     test_equality(cMatrix.data(), rMatrix.data(), rows*cols);
 }
 
+TEST(fourier, shifts_odd_CPU) {
+
+    using impl_type = cpu_fft_impl<float>::fourier;
+
+    // numpy convention: fftshift moves index 0 to n / 2
+    for (unsigned int rows : {6u, 7u})
+        for (unsigned int cols : {1u, 8u, 9u}) {
+
+            impl_type fftImpl(rows, cols);
+            DSmatrix<std::complex<float>, cpu_impl> input(rows, cols);
+            generate_random_values(input.data(), rows*cols, -10.0f, 10.0f);
+            DSmatrix<std::complex<float>, cpu_impl> shifted(input);
+            DSmatrix<std::complex<float>, cpu_impl> outOfPlace(rows, cols);
+
+            fftImpl.fftshift(shifted.data());
+            fftImpl.fftshift(input.data(), outOfPlace.data());
+            for (unsigned int i = 0; i < rows; ++i)
+                for (unsigned int j = 0; j < cols; ++j) {
+                    ASSERT_EQ(shifted((i + rows / 2) % rows, (j + cols / 2) % cols), input(i, j));
+                    ASSERT_EQ(outOfPlace(i, j), shifted(i, j));
+                }
+
+            fftImpl.ifftshift(shifted.data());
+            fftImpl.ifftshift(outOfPlace.data(), shifted.data());
+            test_equality(shifted.data(), input.data(), rows*cols);
+            fftImpl.ifftshift(outOfPlace.data());
+            test_equality(outOfPlace.data(), input.data(), rows*cols);
+
+            // real data
+            DSmatrix<float, cpu_impl> real(rows, cols);
+            generate_random_values(real.data(), rows*cols, -10.0f, 10.0f);
+            DSmatrix<float, cpu_impl> realShifted(rows, cols);
+            fftImpl.ifftshift(real.data(), realShifted.data());
+            fftImpl.fftshift(realShifted.data());
+            test_equality(realShifted.data(), real.data(), rows*cols);
+        }
+}
+
+TEST(fourier, fftWithShifts_odd_CPU) {
+
+    // the centered transform of a centered delta is constant
+    unsigned int rows = 15;
+    unsigned int cols = 25;
+    FourierTransform<float, cpu_impl> fftOp(rows, cols);
+    DSmatrix<std::complex<float>, cpu_impl> delta(rows, cols, std::complex<float>(0));
+    delta(rows / 2, cols / 2) = 1;
+    fftOp.fftWithShifts(delta);
+    for (unsigned int i = 0; i < rows*cols; ++i)
+        ASSERT_NEAR(std::abs(delta.data()[i] - std::complex<float>(1)), 0.0, 1e-6);
+
+    // round trip
+    DSmatrix<std::complex<float>, cpu_impl> input(rows, cols);
+    generate_random_values(input.data(), rows*cols, -1.0f, 1.0f);
+    DSmatrix<std::complex<float>, cpu_impl> output(input);
+    fftOp.fftWithShifts(output);
+    fftOp.ifftWithShifts(output);
+    for (unsigned int i = 0; i < rows*cols; ++i)
+        ASSERT_NEAR(std::abs(output.data()[i] - input.data()[i]), 0.0, 1e-5);
+}
+
 TEST(fourier, fft_CPU) {
 
     unsigned int rows = 1;
@@ -257,6 +350,268 @@ TEST(fourier, fft_CPU) {
     }
 }
 
+TEST(fourier, plannerRigor_wisdom_CPU) {
+
+    unsigned int rows = 32;
+    unsigned int cols = 48;
+    std::string wisdomFile = testing::TempDir() + "noisy_fourier.wisdom";
+
+    using fft_type = FourierTransform<float, cpu_impl>;
+    FourierTransform<float, cpu_impl> fftEstimate(rows, cols);
+    FourierTransform<float, cpu_impl> fftMeasure(rows, cols, FFT_MEASURE);
+    ASSERT_TRUE(fft_type::exportWisdom(wisdomFile));
+    ASSERT_TRUE(fft_type::importWisdom(wisdomFile));
+    ASSERT_FALSE(fft_type::importWisdom(wisdomFile + ".missing"));
+    std::remove(wisdomFile.c_str());
+
+    // planning with wisdom does not change the results
+    FourierTransform<float, cpu_impl> fftPatient(rows, cols, FFT_PATIENT);
+
+    DSmatrix<std::complex<float>, cpu_impl> reference(rows, cols);
+    generate_random_values(reference.data(), rows*cols, 0.0f, 1.0f);
+    DSmatrix<std::complex<float>, cpu_impl> measured(reference);
+    DSmatrix<std::complex<float>, cpu_impl> patient(reference);
+    fftEstimate.fft(reference);
+    fftMeasure.fft(measured);
+    fftPatient.fft(patient);
+    for (unsigned int i = 0; i < rows*cols; ++i) {
+        ASSERT_NEAR(std::abs(measured.data()[i] - reference.data()[i]), 0.0, 1e-3);
+        ASSERT_NEAR(std::abs(patient.data()[i] - reference.data()[i]), 0.0, 1e-3);
+    }
+}
+
+TEST(fourier, threads_CPU) {
+
+    unsigned int rows = 64;
+    unsigned int cols = 96;
+    FourierTransform<float, cpu_impl> fftOp(rows, cols);
+    FourierTransform<float, cpu_impl> fftOpThreaded(rows, cols, FFT_ESTIMATE, 4);
+
+    DSmatrix<std::complex<float>, cpu_impl> reference(rows, cols);
+    generate_random_values(reference.data(), rows*cols, 0.0f, 1.0f);
+    DSmatrix<std::complex<float>, cpu_impl> threaded(reference);
+    fftOp.fftWithShifts(reference);
+    fftOpThreaded.fftWithShifts(threaded);
+    for (unsigned int i = 0; i < rows*cols; ++i)
+        ASSERT_NEAR(std::abs(threaded.data()[i] - reference.data()[i]), 0.0, 1e-3);
+}
+
+TEST(fourier, corrConvBox_CPU) {
+
+    unsigned int rows = 32;
+    unsigned int cols = 48;
+    t_box box = {3, 10, 20, 25};
+    FourierTransform<float, cpu_impl> fftOp(rows, cols);
+
+    DSmatrix<std::complex<float>, cpu_impl> A(rows, cols);
+    DSmatrix<std::complex<float>, cpu_impl> B(box.rows, box.cols);
+    generate_random_values(A.data(), rows*cols, 0.0f, 1.0f);
+    generate_random_values(B.data(), box.rows*box.cols, 0.0f, 1.0f);
+    DSmatrix<std::complex<float>, cpu_impl> BFull(rows, cols);
+    embed(B, box, BFull);
+
+    DSmatrix<std::complex<float>, cpu_impl> result(rows, cols);
+    DSmatrix<std::complex<float>, cpu_impl> reference(rows, cols);
+
+    fftOp.corrFF2F(A, B, box, result);
+    fftOp.corrFF2F(A, BFull, reference);
+    test_equality(result.data(), reference.data(), rows*cols);
+
+    fftOp.convFF2F(A, B, box, result);
+    fftOp.convFF2F(A, BFull, reference);
+    test_equality(result.data(), reference.data(), rows*cols);
+
+    // box wrapping around both edges
+    t_box wrapped = {25, 40, 20, 25};
+    DSmatrix<std::complex<float>, cpu_impl> W(wrapped.rows, wrapped.cols);
+    generate_random_values(W.data(), wrapped.rows*wrapped.cols, 0.0f, 1.0f);
+    DSmatrix<std::complex<float>, cpu_impl> WFull(rows, cols, std::complex<float>(0));
+    for (unsigned int i = 0; i < wrapped.rows; ++i)
+        for (unsigned int j = 0; j < wrapped.cols; ++j)
+            WFull((wrapped.row + i) % rows, (wrapped.col + j) % cols) = W(i, j);
+
+    fftOp.corrFF2F(A, W, wrapped, result);
+    fftOp.corrFF2F(A, WFull, reference);
+    test_equality(result.data(), reference.data(), rows*cols);
+
+    fftOp.convFF2F(A, W, wrapped, result);
+    fftOp.convFF2F(A, WFull, reference);
+    test_equality(result.data(), reference.data(), rows*cols);
+}
+
+TEST(fourier, convFD2D_CPU) {
+
+    unsigned int rows = 32;
+    unsigned int cols = 48;
+    unsigned int size = rows * cols;
+    FourierTransform<float, cpu_impl> fftOp(rows, cols);
+
+    DSmatrix<std::complex<float>, cpu_impl> A(rows, cols);
+    DSmatrix<std::complex<float>, cpu_impl> B(rows, cols);
+    generate_random_values(A.data(), size, 0.0f, 1.0f);
+    generate_random_values(B.data(), size, 0.0f, 1.0f);
+
+    DSmatrix<std::complex<float>, cpu_impl> ACopy(A);
+    DSmatrix<std::complex<float>, cpu_impl> BCopy(B);
+    DSmatrix<std::complex<float>, cpu_impl> reference(rows, cols);
+    fftOp.convDD2D(ACopy, BCopy, reference);
+
+    // A transformed once and used for two convolutions
+    fftOp.fftWithShifts(A);
+    DSmatrix<std::complex<float>, cpu_impl> result(rows, cols);
+    for (unsigned int n = 0; n < 2; ++n) {
+        DSmatrix<std::complex<float>, cpu_impl> BData(B);
+        fftOp.convFD2D(A, BData, result);
+        test_equality(result.data(), reference.data(), size);
+    }
+}
+
+TEST(fourier, rfftWithShifts_CPU) {
+
+    for (unsigned int cols : {48, 47}) {
+
+        unsigned int rows = 32;
+        unsigned int size = rows * cols;
+        FourierTransform<float, cpu_impl> fftOp(rows, cols);
+
+        DSmatrix<float, cpu_impl> image(rows, cols);
+        generate_random_values(image.data(), size, 0.0f, 1.0f);
+
+        DSmatrix<std::complex<float>, cpu_impl> reference(rows, cols);
+        real2complex(image, reference);
+        fftOp.fftWithShifts(reference);
+
+        DSmatrix<std::complex<float>, cpu_impl> spectrum(rows, cols);
+        fftOp.rfftWithShifts(image, spectrum);
+        for (unsigned int i = 0; i < size; ++i)
+            ASSERT_NEAR(std::abs(spectrum.data()[i] - reference.data()[i]), 0.0, 1e-3);
+
+        // a non-Hermitian spectrum: only the real part of the inverse is kept
+        generate_random_values(spectrum.data(), size, 0.0f, 1.0f);
+        DSmatrix<std::complex<float>, cpu_impl> spectrumCopy(spectrum);
+        fftOp.ifftWithShifts(spectrumCopy);
+        DSmatrix<float, cpu_impl> imageRef(rows, cols);
+        complex2real(spectrumCopy, imageRef);
+
+        fftOp.irfftWithShifts(spectrum, image);
+        for (unsigned int i = 0; i < size; ++i)
+            ASSERT_NEAR(image.data()[i], imageRef.data()[i], 1e-5);
+    }
+}
+
+TEST(fourier, fftWithShiftsBatch_CPU) {
+
+    unsigned int rows = 32;
+    unsigned int cols = 48;
+    unsigned int howmany = 3;
+    unsigned int size = rows * cols;
+    FourierTransform<float, cpu_impl> fftOp(rows, cols);
+
+    DSmatrix<std::complex<float>, cpu_impl> batch(howmany * rows, cols);
+    generate_random_values(batch.data(), howmany * size, 0.0f, 1.0f);
+    DSmatrix<std::complex<float>, cpu_impl> input(batch);
+
+    fftOp.fftWithShiftsBatch(batch, howmany);
+    for (unsigned int b = 0; b < howmany; ++b) {
+        DSmatrix<std::complex<float>, cpu_impl> single(rows, cols);
+        std::memcpy(single.data(), input.data() + b * size, size * sizeof(std::complex<float>));
+        fftOp.fftWithShifts(single);
+        for (unsigned int i = 0; i < size; ++i)
+            ASSERT_NEAR(std::abs(single.data()[i] - batch.data()[b * size + i]), 0.0, 1e-3);
+    }
+
+    // round trip
+    fftOp.ifftWithShiftsBatch(batch, howmany);
+    for (unsigned int i = 0; i < howmany * size; ++i)
+        ASSERT_NEAR(std::abs(batch.data()[i] - input.data()[i]), 0.0, 1e-5);
+}
+
+TEST(fourier, batchPlanEviction_CPU) {
+
+    unsigned int rows = 16;
+    unsigned int cols = 24;
+    unsigned int size = rows * cols;
+    FourierTransform<float, cpu_impl> fftOp(rows, cols);
+
+    DSmatrix<std::complex<float>, cpu_impl> single(rows, cols);
+    generate_random_values(single.data(), size, 0.0f, 1.0f);
+    DSmatrix<std::complex<float>, cpu_impl> input(single);
+    fftOp.fftWithShifts(single);
+
+    // more batch sizes than plans kept, then the first one again
+    for (unsigned int howmany : {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 1, 2}) {
+        DSmatrix<std::complex<float>, cpu_impl> batch(howmany * rows, cols);
+        for (unsigned int b = 0; b < howmany; ++b)
+            std::memcpy(batch.data() + b * size, input.data(), size * sizeof(std::complex<float>));
+        fftOp.fftWithShiftsBatch(batch, howmany);
+        for (unsigned int i = 0; i < size; ++i)
+            ASSERT_NEAR(std::abs(single.data()[i] - batch.data()[(howmany - 1) * size + i]), 0.0, 1e-3);
+        fftOp.ifftWithShiftsBatch(batch, howmany);
+        for (unsigned int i = 0; i < size; ++i)
+            ASSERT_NEAR(std::abs(batch.data()[i] - input.data()[i]), 0.0, 1e-5);
+    }
+}
+
+TEST(fourier, planCache_CPU) {
+
+    unsigned int rows = 32;
+    unsigned int cols = 48;
+    using impl_type = cpu_fft_impl<float>::fourier;
+
+    // same shape and options share one set of plans
+    std::shared_ptr<impl_type> first = impl_type::instance(rows, cols);
+    std::shared_ptr<impl_type> second = impl_type::instance(rows, cols);
+    ASSERT_EQ(first.get(), second.get());
+    ASSERT_NE(first.get(), impl_type::instance(rows, cols + 1).get());
+    ASSERT_NE(first.get(), impl_type::instance(rows, cols, FFT_MEASURE).get());
+    ASSERT_NE(first.get(), impl_type::instance(rows, cols, FFT_ESTIMATE, 2).get());
+
+    // transforms sharing the plans give independent results
+    FourierTransform<float, cpu_impl> fftA(rows, cols);
+    FourierTransform<float, cpu_impl> fftB(rows, cols);
+    DSmatrix<std::complex<float>, cpu_impl> a(rows, cols);
+    generate_random_values(a.data(), rows*cols, 0.0f, 1.0f);
+    DSmatrix<std::complex<float>, cpu_impl> b(a);
+    fftA.fftWithShifts(a);
+    fftB.fftWithShifts(b);
+    for (unsigned int i = 0; i < rows*cols; ++i)
+        ASSERT_EQ(a.data()[i], b.data()[i]);
+
+    // clearing keeps the plans in use alive
+    FourierTransform<float, cpu_impl>::clearPlanCache();
+    ASSERT_NE(first.get(), impl_type::instance(rows, cols).get());
+    fftA.ifftWithShifts(a);
+}
+
+TEST(fourier, complexKernels_CPU) {
+
+    testComplexKernels<float>(1e-6);
+    testComplexKernels<double>(1e-14);
+}
+
+TEST(fourier, double_CPU) {
+
+    unsigned int rows = 30;
+    unsigned int cols = 45;
+    FourierTransform<double, cpu_impl> fftOp(rows, cols);
+
+    DSmatrix<double, cpu_impl> image(rows, cols);
+    generate_random_values(image.data(), rows*cols, -1.0, 1.0);
+    DSmatrix<std::complex<double>, cpu_impl> reference(rows, cols);
+    real2complex(image, reference);
+    fftOp.fftWithShifts(reference);
+
+    DSmatrix<std::complex<double>, cpu_impl> spectrum(rows, cols);
+    fftOp.rfftWithShifts(image, spectrum);
+    for (unsigned int i = 0; i < rows*cols; ++i)
+        ASSERT_NEAR(std::abs(spectrum.data()[i] - reference.data()[i]), 0.0, 1e-12);
+
+    DSmatrix<double, cpu_impl> recovered(rows, cols);
+    fftOp.irfftWithShifts(spectrum, recovered);
+    for (unsigned int i = 0; i < rows*cols; ++i)
+        ASSERT_NEAR(recovered.data()[i], image.data()[i], 1e-14);
+}
+
 #ifdef CUDA
 TEST(fourier, constructor_destructor_CUDA) {
 
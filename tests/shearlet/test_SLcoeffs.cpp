@@ -28,6 +28,7 @@
  */
 
 #include <iostream>
+#include <vector>
 
 #include "src/shearlet/SLsystem.hpp"
 
@@ -65,6 +66,26 @@ TYPED_TEST(SLcoeffsTemplate, addElement_CPU) {
     test_equality(myMatrix2.data(), mat->data(), rows*cols);
 }
 
+TYPED_TEST(SLcoeffsTemplate, addElement_move_CPU) {
+
+    SLcoeffs<TypeParam, cpu_impl> coeffs{};
+
+    unsigned int rows = 1024;
+    unsigned int cols =  512;
+
+    DSmatrix<TypeParam, cpu_impl> myMatrix(rows, cols);
+    generate_random_values(myMatrix.data(), rows*cols, TypeParam(-10.0), TypeParam(10.0));
+    DSmatrix<TypeParam, cpu_impl> reference(myMatrix);
+    TypeParam * data = myMatrix.data();
+    coeffs.addElement(std::move(myMatrix));
+
+    // the element owns the original buffer
+    DSmatrix<TypeParam, cpu_impl> *mat = coeffs.getElement(0);
+    ASSERT_EQ(mat->data(), data);
+    ASSERT_TRUE(myMatrix.is_empty());
+    test_equality(mat->data(), reference.data(), rows*cols);
+}
+
 TYPED_TEST(SLcoeffsTemplate, muteShearlet_CPU) {
 
     SLcoeffs<TypeParam, cpu_impl> coeffs{};
@@ -139,6 +160,68 @@ TYPED_TEST(SLcoeffsTemplate, applyThreshold_CPU) {
         ASSERT_EQ(data[i], refData[i]);
 }
 
+// gain of ThresholdRule on the magnitude r
+template <typename T>
+T shrinkReference(T r, ThresholdRule rule, T t, T t2) {
+
+    switch (rule) {
+    case THRESHOLD_HARD:    return r >= t ? T(1) : T(0);
+    case THRESHOLD_SOFT:    return r > t ? (r - t) / r : T(0);
+    case THRESHOLD_GARROTE: return r > t ? (r * r - t * t) / (r * r) : T(0);
+    default:                return r <= t ? T(0) : r >= t2 ? T(1) : t2 * (r - t) / ((t2 - t) * r);
+    }
+}
+
+TYPED_TEST(SLcoeffsTemplate, shrink_CPU) {
+
+    // sizes with a tail shorter than a vector and blocks of several sizes
+    std::vector<t_dims> dims = {{1, 7}, {64, 33}, {257, 129}};
+    std::vector<TypeParam> thresholds = {0.3, 0.5, 0.0};
+    TypeParam firmRatio = 2.5;
+    ThreadPool pool(4);
+
+    for (ThresholdRule rule : {THRESHOLD_HARD, THRESHOLD_SOFT, THRESHOLD_GARROTE, THRESHOLD_FIRM}) {
+        for (ThreadPool * p : {(ThreadPool *)nullptr, &pool}) {
+
+            SLcoeffs<std::complex<TypeParam>, cpu_impl> coeffs;
+            SLcoeffs<TypeParam, cpu_impl> coeffsReal;
+            for (t_dims d : dims) {
+                DSmatrix<std::complex<TypeParam>, cpu_impl> mat(d.rows, d.cols);
+                generate_random_values(mat.data(), mat.size(), TypeParam(-1.0), TypeParam(1.0));
+                coeffs.addElement(mat);
+                DSmatrix<TypeParam, cpu_impl> matReal(d.rows, d.cols);
+                generate_random_values(matReal.data(), matReal.size(), TypeParam(-1.0), TypeParam(1.0));
+                coeffsReal.addElement(matReal);
+            }
+
+            std::vector<DSmatrix<std::complex<TypeParam>, cpu_impl>> reference;
+            std::vector<DSmatrix<TypeParam, cpu_impl>> referenceReal;
+            for (unsigned int i = 0; i < dims.size(); ++i) {
+                reference.emplace_back(*coeffs.getElement(i));
+                referenceReal.emplace_back(*coeffsReal.getElement(i));
+            }
+
+            coeffs.shrink(thresholds, rule, p, firmRatio);
+            coeffsReal.shrink(thresholds, rule, p, firmRatio);
+
+            for (unsigned int i = 0; i < dims.size(); ++i) {
+                TypeParam t = thresholds[i];
+                for (unsigned int k = 0; k < reference[i].size(); ++k) {
+                    std::complex<TypeParam> c = reference[i].data()[k];
+                    std::complex<TypeParam> expected = t == 0 ? c :
+                        c * shrinkReference(std::abs(c), rule, t, firmRatio * t);
+                    ASSERT_NEAR(std::abs(coeffs.getElement(i)->data()[k] - expected), 0.0, 1e-5);
+
+                    TypeParam x = referenceReal[i].data()[k];
+                    TypeParam expectedReal = t == 0 ? x :
+                        x * shrinkReference(std::abs(x), rule, t, firmRatio * t);
+                    ASSERT_NEAR(coeffsReal.getElement(i)->data()[k], expectedReal, 1e-5);
+                }
+            }
+        }
+    }
+}
+
 #ifdef CUDA
 
 TYPED_TEST(SLcoeffsTemplate, addElement_CUDA) {
@@ -28,24 +28,602 @@
  */
 
 #include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <cmath>
 
 #include "src/shearlet/SLsystem.hpp"
+#include "src/shearlet/SLtiled.hpp"
+#include "src/transform/transformMatrix.hpp"
 
 #include <gtest/gtest.h>
 #include "tests/utils/test_utils.hpp"
 
-#include <chrono>
-using namespace std::chrono;
-
 TEST(SLsystem, constructor_destructor_CPU) {
 
     size_t M = 96;
     size_t N = 96;
     size_t Nscales = 1;
 
-    auto start = high_resolution_clock::now();
+    // construction time is tracked by BM_SLsystem_build in noisy_bench
+    SLsystem<float, cpu_impl> Shearlets(M, N, Nscales);
+}
+
+TEST(SLsystem, bank_cache_CPU) {
+
+    size_t M = 96;
+    size_t N = 128;
+    size_t Nscales = 1;
+    std::string fileName = testing::TempDir() + "test_SLsystem_bank.bin";
+    std::remove(fileName.c_str());
+
+    DSmatrix<float, cpu_impl> image(M, N);
+    generate_random_values(image.data(), M*N, 0.0f, 1.0f);
+
+    SLsystem<float, cpu_impl> reference(M, N, Nscales);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffsRef = reference.decode(image);
+
+    // first construction writes the bank
+    {
+        SLsystem<float, cpu_impl> Shearlets(M, N, Nscales, fileName);
+    }
+    std::ifstream bankFile(fileName, std::ios::binary);
+    ASSERT_TRUE(bankFile.good());
+
+    // second construction maps it
+    SLsystem<float, cpu_impl> Shearlets(M, N, Nscales, fileName);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(image);
+    // threaded FFT plans may round differently
+    ASSERT_EQ(coeffs.size(), coeffsRef.size());
+    for (unsigned int i = 0; i < coeffs.size(); ++i)
+        for (unsigned int k = 0; k < M*N; ++k)
+            ASSERT_NEAR(std::abs(coeffs.getElement(i)->data()[k] -
+                                 coeffsRef.getElement(i)->data()[k]), 0.0, 1e-5);
+
+    DSmatrix<float, cpu_impl> recovered = Shearlets.recover(coeffs);
+    for (unsigned int i = 0; i < M*N; ++i)
+        ASSERT_NEAR(recovered.data()[i], image.data()[i], 1e-4);
+
+    std::remove(fileName.c_str());
+}
+
+TEST(SLsystem, bank_cache_key_mismatch_CPU) {
+
+    size_t M = 96;
+    size_t N = 96;
+    std::string fileName = testing::TempDir() + "test_SLsystem_bank_key.bin";
+    std::remove(fileName.c_str());
+
+    {
+        SLsystem<float, cpu_impl> Shearlets(M, N, 1, fileName);
+    }
+
+    // different number of scales: the bank is rebuilt and overwritten
+    SLsystem<float, cpu_impl> Shearlets(M, N, 2, fileName);
+    SLsystem<float, cpu_impl> reference(M, N, 2);
+
+    DSmatrix<float, cpu_impl> image(M, N);
+    generate_random_values(image.data(), M*N, 0.0f, 1.0f);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(image);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffsRef = reference.decode(image);
+    // threaded FFT plans may round differently
+    ASSERT_EQ(coeffs.size(), coeffsRef.size());
+    for (unsigned int i = 0; i < coeffs.size(); ++i)
+        for (unsigned int k = 0; k < M*N; ++k)
+            ASSERT_NEAR(std::abs(coeffs.getElement(i)->data()[k] -
+                                 coeffsRef.getElement(i)->data()[k]), 0.0, 1e-5);
+
+    std::remove(fileName.c_str());
+}
+
+TEST(SLsystem, transposeSymmetry_CPU) {
+
+    size_t M = 96;
+    size_t N = 128;
+    size_t Nscales = 1;
+
+    // the cones of a rows x cols system are the cones of the cols x rows
+    // one swapped: the coefficients of the transposed image are the
+    // transposed coefficients of the other cone with opposite shearing
+    SLsystem<float, cpu_impl> Shearlets(M, N, Nscales);
+    SLsystem<float, cpu_impl> ShearletsT(N, M, Nscales);
+
+    DSmatrix<float, cpu_impl> image(M, N);
+    generate_random_values(image.data(), M*N, 0.0f, 1.0f);
+    DSmatrix<float, cpu_impl> imageT(N, M);
+    transpose(image, imageT);
+
+    SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(image);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffsT = ShearletsT.decode(imageT);
+    ASSERT_EQ(coeffs.size(), coeffsT.size());
+
+    // one scale: the shearings of each cone are stored in order and the
+    // lowpass shearlet comes last
+    unsigned int nCone = (coeffs.size() - 1) / 2;
+    for (unsigned int i = 0; i < coeffs.size(); ++i) {
+        unsigned int j = i + 1 == coeffs.size() ? i : 2 * nCone - 1 - i;
+        double error = 0.0;
+        double norm = 0.0;
+        for (unsigned int r = 0; r < M; ++r)
+            for (unsigned int c = 0; c < N; ++c) {
+                std::complex<float> a = coeffs.getElement(i)->data()[r*N+c];
+                std::complex<float> b = coeffsT.getElement(j)->data()[c*M+r];
+                error += std::norm(a - b);
+                norm += std::norm(a);
+            }
+        ASSERT_LT(std::sqrt(error / norm), 1e-4) << "shearlet " << i;
+    }
+}
+
+TEST(SLsystem, build_parallel_CPU) {
+
+    size_t M = 96;
+    size_t N = 128;
+    size_t Nscales = 2;
+
+    DSmatrix<float, cpu_impl> image(M, N);
+    generate_random_values(image.data(), M*N, 0.0f, 1.0f);
+
+    SLsystem<float, cpu_impl> reference(M, N, Nscales, FFT_ESTIMATE, nullptr, 1);
+    SLsystem<float, cpu_impl> Shearlets(M, N, Nscales, FFT_ESTIMATE, nullptr, 4);
+
+    // every task runs the same operations as in the serial build
+    SLcoeffs<std::complex<float>, cpu_impl> coeffsRef = reference.decode(image);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(image);
+    ASSERT_EQ(coeffs.size(), coeffsRef.size());
+    for (unsigned int i = 0; i < coeffs.size(); ++i)
+        for (unsigned int k = 0; k < M*N; ++k)
+            ASSERT_EQ(coeffs.getElement(i)->data()[k], coeffsRef.getElement(i)->data()[k]);
+}
+
+TEST(SLsystem, decode_parallel_CPU) {
+
+    size_t M = 96;
+    size_t N = 128;
+    size_t Nscales = 2;
+
+    DSmatrix<float, cpu_impl> image(M, N);
+    generate_random_values(image.data(), M*N, 0.0f, 1.0f);
+
+    SLsystem<float, cpu_impl> Shearlets(M, N, Nscales);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffsRef = Shearlets.decode(image);
+
+    Shearlets.setNumThreads(4);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(image);
+
+    // threaded FFT plans may round differently
+    ASSERT_EQ(coeffs.size(), coeffsRef.size());
+    for (unsigned int i = 0; i < coeffs.size(); ++i)
+        for (unsigned int k = 0; k < M*N; ++k)
+            ASSERT_NEAR(std::abs(coeffs.getElement(i)->data()[k] -
+                                 coeffsRef.getElement(i)->data()[k]), 0.0, 1e-5);
+
+    DSmatrix<float, cpu_impl> recovered = Shearlets.recover(coeffs);
+    for (unsigned int i = 0; i < M*N; ++i)
+        ASSERT_NEAR(recovered.data()[i], image.data()[i], 1e-4);
+}
+
+TEST(SLsystem, batch_CPU) {
+
+    size_t M = 96;
+    size_t N = 128;
+    size_t Nscales = 2;
+    unsigned int nImages = 3;
+
+    SLsystem<float, cpu_impl> Shearlets(M, N, Nscales);
+
+    std::vector<DSmatrix<float, cpu_impl>> images;
+    images.reserve(nImages);
+    for (unsigned int b = 0; b < nImages; ++b) {
+        images.emplace_back(M, N);
+        generate_random_values(images[b].data(), M*N, 0.0f, 1.0f);
+    }
+
+    for (unsigned int nThreads : {1, 3}) {
+
+        Shearlets.setNumThreads(nThreads);
+        std::vector<SLcoeffs<std::complex<float>, cpu_impl>> coeffs = Shearlets.decodeBatch(images);
+        ASSERT_EQ(coeffs.size(), nImages);
+
+        for (unsigned int b = 0; b < nImages; ++b) {
+            SLcoeffs<std::complex<float>, cpu_impl> coeffsRef = Shearlets.decode(images[b]);
+            ASSERT_EQ(coeffs[b].size(), coeffsRef.size());
+            for (unsigned int i = 0; i < coeffsRef.size(); ++i)
+                for (unsigned int k = 0; k < M*N; ++k)
+                    ASSERT_NEAR(std::abs(coeffs[b].getElement(i)->data()[k] -
+                                         coeffsRef.getElement(i)->data()[k]), 0.0, 1e-5);
+        }
+
+        std::vector<DSmatrix<float, cpu_impl>> recovered = Shearlets.recoverBatch(coeffs);
+        ASSERT_EQ(recovered.size(), nImages);
+        for (unsigned int b = 0; b < nImages; ++b)
+            for (unsigned int k = 0; k < M*N; ++k)
+                ASSERT_NEAR(recovered[b].data()[k], images[b].data()[k], 1e-4);
+    }
+}
+
+TEST(SLsystem, denoise_CPU) {
+
+    size_t M = 96;
+    size_t N = 128;
+    size_t Nscales = 2;
+
+    DSmatrix<float, cpu_impl> image(M, N);
+    generate_random_values(image.data(), M*N, 0.0f, 1.0f);
+
+    SLsystem<float, cpu_impl> Shearlets(M, N, Nscales);
+
+    SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(image);
+    std::vector<std::complex<float>> thresholds(coeffs.size());
+    for (unsigned int i = 0; i < coeffs.size(); ++i)
+        thresholds[i] = std::complex<float>(0.01f * (i % 4), 0.0f);
+    coeffs.applyThreshold(thresholds);
+    DSmatrix<float, cpu_impl> reference = Shearlets.recover(coeffs);
+
+    for (unsigned int nThreads : {1, 3}) {
+
+        Shearlets.setNumThreads(nThreads);
+        DSmatrix<float, cpu_impl> denoised = Shearlets.denoise(image, thresholds);
+        for (unsigned int k = 0; k < M*N; ++k)
+            ASSERT_NEAR(denoised.data()[k], reference.data()[k], 1e-4);
+    }
+}
+
+TEST(SLsystem, thresholds_CPU) {
+
+    size_t M = 96;
+    size_t N = 128;
+    size_t Nscales = 2;
+
     SLsystem<float, cpu_impl> Shearlets(M, N, Nscales);
-    auto stop = high_resolution_clock::now();
-    auto duration = duration_cast<milliseconds>(stop - start);
-    std::cout << "Timing system = " << duration.count() << std::endl;
+
+    // the coefficients of white noise have the predicted deviation
+    DSmatrix<float, cpu_impl> noise(M, N);
+    generate_random_values(noise.data(), M*N, -1.0f, 1.0f);
+    float sigma = 1.0f / std::sqrt(3.0f);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(noise);
+    std::vector<float> levels = Shearlets.noiseLevels();
+    ASSERT_EQ(levels.size(), coeffs.size());
+    for (unsigned int i = 0; i < coeffs.size(); ++i) {
+        double power = 0.0;
+        for (unsigned int k = 0; k < M*N; ++k)
+            power += std::norm(coeffs.getElement(i)->data()[k]);
+        // the lowpass shearlet also sees the mean of the noise
+        if (i + 1 < coeffs.size()) {
+            ASSERT_NEAR(std::sqrt(power / (M*N)) / (sigma * levels[i]), 1.0, 0.1);
+        }
+    }
+
+    // per scale: the lowpass shearlet is not thresholded
+    std::vector<float> thresholds = Shearlets.thresholds(0.1f, {3.0f, 4.0f});
+    ASSERT_EQ(thresholds.size(), coeffs.size());
+    ASSERT_EQ(thresholds.back(), 0.0f);
+    ASSERT_FLOAT_EQ(thresholds[0], 3.0f * 0.1f * levels[0]);
+    ASSERT_FLOAT_EQ(thresholds[thresholds.size() - 2], 4.0f * 0.1f * levels[thresholds.size() - 2]);
+
+    // per shearlet
+    std::vector<float> factors(coeffs.size(), 2.0f);
+    std::vector<float> perShearlet = Shearlets.thresholds(0.1f, factors);
+    for (unsigned int i = 0; i < coeffs.size(); ++i)
+        ASSERT_FLOAT_EQ(perShearlet[i], 0.2f * levels[i]);
+
+    // the streaming denoise matches decode, shrink and recover
+    DSmatrix<float, cpu_impl> image(M, N);
+    generate_random_values(image.data(), M*N, 0.0f, 1.0f);
+    for (ThresholdRule rule : {THRESHOLD_SOFT, THRESHOLD_FIRM}) {
+        SLcoeffs<std::complex<float>, cpu_impl> imageCoeffs = Shearlets.decode(image);
+        imageCoeffs.shrink(thresholds, rule);
+        DSmatrix<float, cpu_impl> reference = Shearlets.recover(imageCoeffs);
+        DSmatrix<float, cpu_impl> denoised = Shearlets.denoise(image, thresholds, rule);
+        for (unsigned int k = 0; k < M*N; ++k)
+            ASSERT_NEAR(denoised.data()[k], reference.data()[k], 1e-5);
+    }
+}
+
+TEST(SLsystem, estimateNoise_CPU) {
+
+    size_t M = 96;
+    size_t N = 128;
+    size_t Nscales = 2;
+    float sigma = 0.1f;
+
+    SLsystem<float, cpu_impl> Shearlets(M, N, Nscales);
+
+    // smooth image plus white gaussian noise
+    std::mt19937 generator(3);
+    std::normal_distribution<float> normal(0.0f, sigma);
+    DSmatrix<float, cpu_impl> image(M, N);
+    for (unsigned int r = 0; r < M; ++r)
+        for (unsigned int c = 0; c < N; ++c)
+            image.data()[r*N+c] = 0.5f + 0.3f * std::sin(0.1f * r) * std::cos(0.07f * c)
+                                  + normal(generator);
+
+    float estimate = Shearlets.estimateNoise(image);
+    ASSERT_NEAR(estimate / sigma, 1.0f, 0.1f);
+
+    // same samples from the decoded coefficients, and with a pool
+    SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(image);
+    ASSERT_FLOAT_EQ(Shearlets.estimateNoise(coeffs), estimate);
+    Shearlets.setNumThreads(3);
+    ASSERT_FLOAT_EQ(Shearlets.estimateNoise(image), estimate);
+    ASSERT_FLOAT_EQ(Shearlets.estimateNoise(coeffs), estimate);
+
+    std::vector<float> factors = {3.0f, 4.0f};
+    std::vector<float> thresholds = Shearlets.estimateThresholds(image, factors);
+    std::vector<float> reference = Shearlets.thresholds(estimate, factors);
+    ASSERT_EQ(thresholds.size(), reference.size());
+    for (unsigned int i = 0; i < thresholds.size(); ++i)
+        ASSERT_FLOAT_EQ(thresholds[i], reference[i]);
+}
+
+TEST(SLsystem, shiftFree_CPU) {
+
+    size_t M = 96;
+    size_t N = 128;
+    size_t Nscales = 2;
+    unsigned int nImages = 2;
+
+    std::vector<DSmatrix<float, cpu_impl>> images;
+    images.reserve(nImages);
+    for (unsigned int b = 0; b < nImages; ++b) {
+        images.emplace_back(M, N);
+        generate_random_values(images[b].data(), M*N, 0.0f, 1.0f);
+    }
+
+    SLsystem<float, cpu_impl> Shearlets(M, N, Nscales);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffsRef = Shearlets.decode(images[0]);
+    std::vector<std::complex<float>> thresholds(coeffsRef.size());
+    for (unsigned int i = 0; i < coeffsRef.size(); ++i)
+        thresholds[i] = std::complex<float>(0.01f * (i % 4), 0.0f);
+    DSmatrix<float, cpu_impl> denoisedRef = Shearlets.denoise(images[0], thresholds);
+
+    Shearlets.setShiftFree(true);
+    for (unsigned int nThreads : {1, 3}) {
+
+        Shearlets.setNumThreads(nThreads);
+
+        // same coefficients as the centered mode
+        SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(images[0]);
+        ASSERT_EQ(coeffs.size(), coeffsRef.size());
+        for (unsigned int i = 0; i < coeffsRef.size(); ++i)
+            for (unsigned int k = 0; k < M*N; ++k)
+                ASSERT_NEAR(std::abs(coeffs.getElement(i)->data()[k] -
+                                     coeffsRef.getElement(i)->data()[k]), 0.0, 1e-5);
+
+        DSmatrix<float, cpu_impl> recovered = Shearlets.recover(coeffs);
+        for (unsigned int k = 0; k < M*N; ++k)
+            ASSERT_NEAR(recovered.data()[k], images[0].data()[k], 1e-4);
+
+        DSmatrix<float, cpu_impl> denoised = Shearlets.denoise(images[0], thresholds);
+        for (unsigned int k = 0; k < M*N; ++k)
+            ASSERT_NEAR(denoised.data()[k], denoisedRef.data()[k], 1e-4);
+
+        std::vector<SLcoeffs<std::complex<float>, cpu_impl>> coeffsBatch = Shearlets.decodeBatch(images);
+        std::vector<DSmatrix<float, cpu_impl>> recoveredBatch = Shearlets.recoverBatch(coeffsBatch);
+        for (unsigned int i = 0; i < coeffsRef.size(); ++i)
+            for (unsigned int k = 0; k < M*N; ++k)
+                ASSERT_NEAR(std::abs(coeffsBatch[0].getElement(i)->data()[k] -
+                                     coeffsRef.getElement(i)->data()[k]), 0.0, 1e-5);
+        for (unsigned int b = 0; b < nImages; ++b)
+            for (unsigned int k = 0; k < M*N; ++k)
+                ASSERT_NEAR(recoveredBatch[b].data()[k], images[b].data()[k], 1e-4);
+    }
+
+    // back to the centered mode
+    Shearlets.setShiftFree(false);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(images[0]);
+    for (unsigned int k = 0; k < M*N; ++k)
+        ASSERT_NEAR(std::abs(coeffs.getElement(1)->data()[k] -
+                             coeffsRef.getElement(1)->data()[k]), 0.0, 1e-5);
+}
+
+TEST(SLsystem, odd_size_CPU) {
+
+    size_t M = 95;
+    size_t N = 125;
+    size_t Nscales = 2;
+
+    DSmatrix<float, cpu_impl> image(M, N);
+    generate_random_values(image.data(), M*N, 0.0f, 1.0f);
+
+    SLsystem<float, cpu_impl> Shearlets(M, N, Nscales);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffsRef = Shearlets.decode(image);
+    {
+        // recover overwrites its input
+        SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(image);
+        DSmatrix<float, cpu_impl> recovered = Shearlets.recover(coeffs);
+        for (unsigned int k = 0; k < M*N; ++k)
+            ASSERT_NEAR(recovered.data()[k], image.data()[k], 1e-4);
+    }
+
+    // the unshifted boxes wrap differently for odd sizes
+    Shearlets.setShiftFree(true);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(image);
+    for (unsigned int i = 0; i < coeffsRef.size(); ++i)
+        for (unsigned int k = 0; k < M*N; ++k)
+            ASSERT_NEAR(std::abs(coeffs.getElement(i)->data()[k] -
+                                 coeffsRef.getElement(i)->data()[k]), 0.0, 1e-5);
+    DSmatrix<float, cpu_impl> recovered = Shearlets.recover(coeffs);
+    for (unsigned int k = 0; k < M*N; ++k)
+        ASSERT_NEAR(recovered.data()[k], image.data()[k], 1e-4);
+}
+
+TEST(SLsystem, double_CPU) {
+
+    size_t M = 96;
+    size_t N = 128;
+    size_t Nscales = 2;
+
+    DSmatrix<double, cpu_impl> image(M, N);
+    generate_random_values(image.data(), M*N, 0.0, 1.0);
+
+    SLsystem<double, cpu_impl> Shearlets(M, N, Nscales);
+    for (bool shiftFree : {false, true}) {
+
+        Shearlets.setShiftFree(shiftFree);
+        SLcoeffs<std::complex<double>, cpu_impl> coeffs = Shearlets.decode(image);
+        DSmatrix<double, cpu_impl> recovered = Shearlets.recover(coeffs);
+        for (unsigned int k = 0; k < M*N; ++k)
+            ASSERT_NEAR(recovered.data()[k], image.data()[k], 1e-10);
+    }
+}
+
+TEST(SLsystem, instrumentation_CPU) {
+
+    size_t M = 96;
+    size_t N = 128;
+    size_t Nscales = 2;
+
+    DSmatrix<float, cpu_impl> image(M, N);
+    generate_random_values(image.data(), M*N, 0.0f, 1.0f);
+
+    std::vector<int> filterLevels;
+    Instrumentation instr([&](const t_instrEvent& event) {
+        if (event.stage == INSTR_FILTERS)
+            filterLevels.push_back(event.index);
+    });
+
+    // one shear level (1) per cone
+    SLsystem<float, cpu_impl> Shearlets(M, N, Nscales, FFT_ESTIMATE, &instr);
+    ASSERT_EQ(instr.stats(INSTR_FILTERS).calls, 2);
+    ASSERT_EQ(filterLevels, std::vector<int>({1, 1}));
+
+    for (unsigned int nThreads : {1, 4}) {
+
+        Shearlets.setNumThreads(nThreads);
+        instr.reset();
+        SLcoeffs<std::complex<float>, cpu_impl> coeffs = Shearlets.decode(image);
+        unsigned int nShearlets = coeffs.size();
+
+        ASSERT_EQ(instr.stats(INSTR_RFFT).calls, 1);
+        ASSERT_EQ(instr.stats(INSTR_ANALYZE).calls, nShearlets);
+        ASSERT_EQ(instr.stats(INSTR_CORRELATE).calls, nShearlets);
+        ASSERT_EQ(instr.stats(INSTR_IFFT).calls, nShearlets);
+        // ifftshift and fftshift around each transform
+        ASSERT_EQ(instr.stats(INSTR_SHIFT).calls, 2 + 2 * nShearlets);
+        ASSERT_EQ(instr.stats(INSTR_RFFT).bytes, M*N * (sizeof(float) + 2 * sizeof(std::complex<float>)));
+        ASSERT_GT(instr.stats(INSTR_ANALYZE).seconds, 0.0);
+
+        instr.reset();
+        Shearlets.recover(coeffs);
+        ASSERT_EQ(instr.stats(INSTR_SYNTHESIZE).calls, nShearlets);
+        ASSERT_EQ(instr.stats(INSTR_FFT).calls, nShearlets);
+        ASSERT_EQ(instr.stats(INSTR_CONVOLVE).calls, nShearlets);
+        ASSERT_EQ(instr.stats(INSTR_ACCUMULATE).calls, nShearlets);
+        ASSERT_EQ(instr.stats(INSTR_NORMALIZE).calls, 1);
+        ASSERT_EQ(instr.stats(INSTR_IRFFT).calls, 1);
+    }
+
+    // detached: nothing is recorded
+    Shearlets.setInstrumentation(nullptr);
+    instr.reset();
+    Shearlets.decode(image);
+    for (unsigned int s = 0; s < INSTR_NSTAGES; ++s)
+        ASSERT_EQ(instr.stats(InstrStage(s)).calls, 0);
+}
+
+TEST(SLsystem, tiled_identity_CPU) {
+
+    size_t Nscales = 1;
+    SLtiled<float, cpu_impl> tiled(96, 128, 24, Nscales);
+    auto identity = [](SLsystem<float, cpu_impl>&, DSmatrix<float, cpu_impl>& tile) {
+        return DSmatrix<float, cpu_impl>(tile);
+    };
+
+    // the second image is thinner than a tile and gets mirror padded
+    for (t_dims dims : {t_dims{230, 250}, t_dims{40, 250}}) {
+
+        // image and result are windows of larger buffers
+        DSmatrix<float, cpu_impl> buffer(dims.rows + 10, dims.cols + 20);
+        generate_random_values(buffer.data(), buffer.size(), 0.0f, 1.0f);
+        DSmatrixView<float, cpu_impl> image = buffer.view(t_box{3, 5, dims.rows, dims.cols});
+        DSmatrix<float, cpu_impl> resultBuffer(dims.rows, 2 * dims.cols, -1.0f);
+        DSmatrixView<float, cpu_impl> result = resultBuffer.view().subsample(1, 2);
+
+        tiled.process(image, result, identity);
+        for (unsigned int i = 0; i < dims.rows; ++i)
+            for (unsigned int j = 0; j < dims.cols; ++j) {
+                ASSERT_NEAR(result(i,j), image(i,j), 1e-5);
+                ASSERT_EQ(resultBuffer(i,2*j+1), -1.0f);
+            }
+
+        // the same through files
+        std::string imageFile = testing::TempDir() + "test_SLtiled_image.raw";
+        std::string resultFile = testing::TempDir() + "test_SLtiled_result.raw";
+        DSmatrix<float, cpu_impl> imageCopy(dims);
+        copy(image, imageCopy.view());
+        {
+            std::ofstream out(imageFile, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(imageCopy.data()), imageCopy.size() * sizeof(float));
+        }
+        tiled.process(imageFile, resultFile, dims.rows, dims.cols, identity);
+        DSmatrix<float, cpu_impl> resultDisk(dims);
+        {
+            std::ifstream in(resultFile, std::ios::binary);
+            in.read(reinterpret_cast<char*>(resultDisk.data()), resultDisk.size() * sizeof(float));
+            ASSERT_TRUE(in.good());
+        }
+        for (unsigned int k = 0; k < imageCopy.size(); ++k)
+            ASSERT_NEAR(resultDisk.data()[k], imageCopy.data()[k], 1e-5);
+        std::remove(imageFile.c_str());
+        std::remove(resultFile.c_str());
+    }
+}
+
+TEST(SLsystem, tiled_denoise_CPU) {
+
+    size_t M = 96;
+    size_t N = 96;
+    size_t Nscales = 1;
+    SLtiled<float, cpu_impl> tiled(M, N, 24, Nscales);
+
+    DSmatrix<float, cpu_impl> image(M, N);
+    generate_random_values(image.data(), M*N, 0.0f, 1.0f);
+    SLcoeffs<std::complex<float>, cpu_impl> coeffs = tiled.system().decode(image);
+    std::vector<std::complex<float>> thresholds(coeffs.size());
+    for (unsigned int i = 0; i < coeffs.size(); ++i)
+        thresholds[i] = std::complex<float>(0.01f * (i % 4), 0.0f);
+
+    // a single tile is plain denoising
+    DSmatrix<float, cpu_impl> reference = tiled.system().denoise(image, thresholds);
+    DSmatrix<float, cpu_impl> denoised(M, N);
+    tiled.denoise(image.view(), denoised.view(), thresholds);
+    for (unsigned int k = 0; k < M*N; ++k)
+        ASSERT_NEAR(denoised.data()[k], reference.data()[k], 1e-5);
+
+    // several tiles, in memory and through files
+    t_dims dims = {150, 170};
+    DSmatrix<float, cpu_impl> large(dims);
+    generate_random_values(large.data(), large.size(), 0.0f, 1.0f);
+    DSmatrix<float, cpu_impl> largeDenoised(dims);
+    tiled.denoise(large.view(), largeDenoised.view(), thresholds);
+
+    std::string imageFile = testing::TempDir() + "test_SLtiled_image.raw";
+    std::string resultFile = testing::TempDir() + "test_SLtiled_result.raw";
+    {
+        std::ofstream out(imageFile, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(large.data()), large.size() * sizeof(float));
+    }
+    tiled.denoise(imageFile, resultFile, dims.rows, dims.cols, thresholds);
+    DSmatrix<float, cpu_impl> resultDisk(dims);
+    {
+        std::ifstream in(resultFile, std::ios::binary);
+        in.read(reinterpret_cast<char*>(resultDisk.data()), resultDisk.size() * sizeof(float));
+        ASSERT_TRUE(in.good());
+    }
+    for (unsigned int k = 0; k < large.size(); ++k)
+        ASSERT_NEAR(resultDisk.data()[k], largeDenoised.data()[k], 1e-5);
+    std::remove(imageFile.c_str());
+    std::remove(resultFile.c_str());
+
+    // without thresholds the blend reconstructs the image
+    std::vector<std::complex<float>> zeros(coeffs.size(), std::complex<float>(0.0f, 0.0f));
+    tiled.denoise(large.view(), largeDenoised.view(), zeros);
+    for (unsigned int k = 0; k < large.size(); ++k)
+        ASSERT_NEAR(largeDenoised.data()[k], large.data()[k], 1e-4);
+
+    ASSERT_THROW(tiled.denoise(imageFile, resultFile, dims.rows, dims.cols, thresholds),
+                 std::runtime_error);
 }
@@ -37,6 +37,7 @@
 #include "src/backend/cuda/backendCUDA.hpp"
 #endif
 #include "src/transform/transformMatrix.hpp"
+#include "src/backend/cpu/backendCPUgemm.hpp"
 #include "tests/utils/test_utils.hpp"
 
 #include <gtest/gtest.h>
@@ -145,6 +146,41 @@ TEST(transform, pad_CPU) {
             ASSERT_EQ(myMatrixPad(i,j), 0);
 }
 
+TEST(transform, support_crop_embed_CPU) {
+
+    unsigned int rows = 32;
+    unsigned int cols = 64;
+    t_box box = {5, 17, 12, 20};
+    DSmatrix<float, cpu_impl> myMatrix(rows, cols, 0.0f);
+    for (unsigned int i = box.row; i < box.row + box.rows; ++i)
+        for (unsigned int j = box.col; j < box.col + box.cols; ++j)
+            myMatrix(i,j) = 1.0f;
+    // below the tolerance
+    myMatrix(0,0) = 1e-3f;
+
+    t_box boxSupport = support<float, cpu_impl>(myMatrix, 1e-2f);
+    ASSERT_EQ(boxSupport.row , box.row );
+    ASSERT_EQ(boxSupport.col , box.col );
+    ASSERT_EQ(boxSupport.rows, box.rows);
+    ASSERT_EQ(boxSupport.cols, box.cols);
+
+    generate_random_values(myMatrix.data(), rows*cols, -10.0f, 10.0f);
+    DSmatrix<float, cpu_impl> myMatrixCrop(box.rows, box.cols);
+    crop<float, cpu_impl>(myMatrix, box, myMatrixCrop);
+    for (unsigned int i = 0; i < box.rows; ++i)
+        for (unsigned int j = 0; j < box.cols; ++j)
+            ASSERT_EQ(myMatrixCrop(i,j), myMatrix(box.row+i,box.col+j));
+
+    DSmatrix<float, cpu_impl> myMatrixEmbed(rows, cols);
+    embed<float, cpu_impl>(myMatrixCrop, box, myMatrixEmbed);
+    for (unsigned int i = 0; i < rows; ++i)
+        for (unsigned int j = 0; j < cols; ++j) {
+            bool inside = i >= box.row && i < box.row + box.rows &&
+                          j >= box.col && j < box.col + box.cols;
+            ASSERT_EQ(myMatrixEmbed(i,j), inside ? myMatrix(i,j) : 0.0f);
+        }
+}
+
 TEST(transform, transpose_CPU) {
 
     unsigned int rows = 32;
@@ -158,6 +194,182 @@ TEST(transform, transpose_CPU) {
     test_equality(myMatrixTranspose.data(), myMatrixSolution.data(), rows*cols);
 }
 
+TEST(transform, view_CPU) {
+
+    unsigned int rows = 40;
+    unsigned int cols = 56;
+    DSmatrix<float, cpu_impl> myMatrix(rows, cols);
+    generate_random_values(myMatrix.data(), rows*cols, -10.0f, 10.0f);
+
+    DSmatrixView<float, cpu_impl> full = myMatrix.view();
+    ASSERT_TRUE(full.is_contiguous());
+    DSmatrixView<float, cpu_impl> tile = myMatrix.view(t_box{5, 7, 20, 30});
+    ASSERT_FALSE(tile.is_contiguous());
+    ASSERT_EQ(tile.offset(), 5 * long(cols) + 7);
+    DSmatrixView<float, cpu_impl> sub = tile.subsample(3, 2, 1, 1);
+    ASSERT_EQ(sub.dims().rows, 7U);
+    ASSERT_EQ(sub.dims().cols, 15U);
+    DSmatrixView<float, cpu_impl> subT = sub.transposed();
+    for (unsigned int i = 0; i < sub.dims().rows; ++i)
+        for (unsigned int j = 0; j < sub.dims().cols; ++j) {
+            ASSERT_EQ(sub(i,j), myMatrix(5 + 1 + 3*i, 7 + 1 + 2*j));
+            ASSERT_EQ(subT(j,i), sub(i,j));
+        }
+
+    // writes go through to the underlying matrix, outside stays untouched
+    DSmatrix<float, cpu_impl> reference(myMatrix);
+    fill(sub, 0.0f);
+    for (unsigned int i = 0; i < rows; ++i)
+        for (unsigned int j = 0; j < cols; ++j) {
+            bool inSub = i >= 6 && (i - 6) % 3 == 0 && i < 6 + 3*7 &&
+                         j >= 8 && (j - 8) % 2 == 0 && j < 8 + 2*15;
+            ASSERT_EQ(myMatrix(i,j), inSub ? 0.0f : reference(i,j));
+        }
+}
+
+TEST(transform, view_helpers_CPU) {
+
+    unsigned int rows = 48;
+    unsigned int cols = 72;
+    t_box box{6, 10, 33, 45};
+    DSmatrix<float, cpu_impl> myMatrix(rows, cols);
+    generate_random_values(myMatrix.data(), rows*cols, -10.0f, 10.0f);
+    DSmatrix<float, cpu_impl> tileCopy(box.rows, box.cols);
+    crop(myMatrix, box, tileCopy);
+    DSmatrixView<float, cpu_impl> tile = myMatrix.view(box);
+
+    // every helper on the view must match the contiguous path on a copy
+    DSmatrix<float, cpu_impl> ref(downsample(tileCopy, 1, 3));
+    DSmatrix<float, cpu_impl> out(ref.dims());
+    downsample(tileCopy, 1, 3, &ref);
+    downsample(tile, 1, 3, out.view());
+    test_equality(out.data(), ref.data(), ref.size());
+
+    ref = DSmatrix<float, cpu_impl>(upsample(tileCopy, 0, 2));
+    out = DSmatrix<float, cpu_impl>(ref.dims());
+    upsample(tileCopy, 0, 2, &ref);
+    upsample(tile, 0, 2, out.view());
+    test_equality(out.data(), ref.data(), ref.size());
+
+    ref = DSmatrix<float, cpu_impl>(40, 50);
+    out = DSmatrix<float, cpu_impl>(40, 50);
+    pad(tileCopy, ref);
+    pad(tile, out.view());
+    test_equality(out.data(), ref.data(), ref.size());
+
+    ref = DSmatrix<float, cpu_impl>(box.cols, box.rows);
+    out = DSmatrix<float, cpu_impl>(box.cols, box.rows);
+    transpose(tileCopy, ref);
+    transpose(tile, out.view());
+    test_equality(out.data(), ref.data(), ref.size());
+
+    // transposing into a strided destination: every other column of a
+    // larger buffer
+    DSmatrix<float, cpu_impl> wide(box.cols, 2*box.rows, 1.0f);
+    transpose(tile, wide.view().subsample(1, 2));
+    for (unsigned int i = 0; i < box.cols; ++i)
+        for (unsigned int j = 0; j < box.rows; ++j) {
+            ASSERT_EQ(wide(i,2*j), ref(i,j));
+            ASSERT_EQ(wide(i,2*j+1), 1.0f);
+        }
+
+    t_box inner{3, 4, 10, 12};
+    ref = DSmatrix<float, cpu_impl>(inner.rows, inner.cols);
+    out = DSmatrix<float, cpu_impl>(inner.rows, inner.cols);
+    crop(tileCopy, inner, ref);
+    crop(tile, inner, out.view());
+    test_equality(out.data(), ref.data(), ref.size());
+
+    DSmatrix<float, cpu_impl> embedded(box.rows, box.cols);
+    DSmatrix<float, cpu_impl> embeddedRef(box.rows, box.cols);
+    embed(ref, inner, embeddedRef);
+    embed(ref.view(), inner, embedded.view());
+    test_equality(embedded.data(), embeddedRef.data(), embeddedRef.size());
+}
+
+template<typename T>
+void matMulCPU(const T *inL, const T *inR, T *out,
+               unsigned int m, unsigned int k, unsigned int n) {
+
+    for (unsigned int i = 0; i < m; ++i)
+        for (unsigned int j = 0; j < n; ++j) {
+            T sum = 0;
+            for (unsigned int p = 0; p < k; ++p)
+                sum += inL[i*k+p] * inR[p*n+j];
+            out[i*n+j] = sum;
+        }
+}
+
+template<typename T>
+void test_gemm(unsigned int m, unsigned int k, unsigned int n, ThreadPool * pool = nullptr) {
+
+    std::vector<T> A(m*k), B(k*n), C(m*n, T(7)), reference(m*n);
+    generate_random_values(A.data(), A.size(), T(-1), T(1));
+    generate_random_values(B.data(), B.size(), T(-1), T(1));
+    matMulCPU(A.data(), B.data(), reference.data(), m, k, n);
+
+    // the output is overwritten, not accumulated
+    cpu::details::gemmNative(A.data(), B.data(), C.data(), m, k, n, pool);
+    for (unsigned int i = 0; i < m*n; ++i)
+        ASSERT_NEAR(C[i], reference[i], 1e-5 * k) << m << "x" << k << "x" << n;
+}
+
+TEST(transform, gemm_CPU) {
+
+    // edge tiles, several panels of k, several blocks of m and a product
+    // large enough to be split over the pool
+    ThreadPool pool(3);
+    for (auto size : {std::array<unsigned int, 3>{1, 1, 1},
+                      std::array<unsigned int, 3>{7, 13, 5},
+                      std::array<unsigned int, 3>{100, 300, 70},
+                      std::array<unsigned int, 3>{197, 260, 611}}) {
+        test_gemm<float>(size[0], size[1], size[2]);
+        test_gemm<double>(size[0], size[1], size[2]);
+        test_gemm<float>(size[0], size[1], size[2], &pool);
+        test_gemm<double>(size[0], size[1], size[2], &pool);
+    }
+
+    std::vector<float> C(12, 1.0f);
+    cpu::details::gemmNative<float>(nullptr, nullptr, C.data(), 3, 0, 4);
+    for (float c : C)
+        ASSERT_EQ(c, 0.0f);
+
+    // same through the dispatch (BLAS when enabled)
+    std::vector<double> D(12, 1.0);
+    const double * none = nullptr;
+    cpu::details::gemm(none, none, D.data(), 3, 0, 4);
+    for (double d : D)
+        ASSERT_EQ(d, 0.0);
+}
+
+TEST(transform, matMul_CPU) {
+
+    unsigned int m = 37;
+    unsigned int k = 19;
+    unsigned int n = 41;
+    DSmatrix<float, cpu_impl> L(m, k);
+    DSmatrix<float, cpu_impl> R(k, n);
+    generate_random_values(L.data(), m*k, -1.0f, 1.0f);
+    generate_random_values(R.data(), k*n, -1.0f, 1.0f);
+    DSmatrix<float, cpu_impl> out(m, n, 3.0f);
+    DSmatrix<float, cpu_impl> reference(m, n);
+    matMulCPU(L.data(), R.data(), reference.data(), m, k, n);
+    matMul(L, R, out);
+    for (unsigned int i = 0; i < m*n; ++i)
+        ASSERT_NEAR(out.data()[i], reference.data()[i], 1e-4);
+
+    DSmatrix<std::complex<float>, cpu_impl> Lc(m, k);
+    DSmatrix<std::complex<float>, cpu_impl> Rc(k, n);
+    generate_random_values(Lc.data(), m*k, -1.0f, 1.0f);
+    generate_random_values(Rc.data(), k*n, -1.0f, 1.0f);
+    DSmatrix<std::complex<float>, cpu_impl> outc(m, n);
+    DSmatrix<std::complex<float>, cpu_impl> referencec(m, n);
+    matMulCPU(Lc.data(), Rc.data(), referencec.data(), m, k, n);
+    matMul(Lc, Rc, outc);
+    for (unsigned int i = 0; i < m*n; ++i)
+        ASSERT_NEAR(std::abs(outc.data()[i] - referencec.data()[i]), 0.0f, 1e-4);
+}
+
 TEST(transform, normL2_CPU) {
 
     unsigned int rows = 32;
@@ -227,6 +439,48 @@ TEST(transform, convolve_dims_CPU) {
     ASSERT_EQ(outDims.cols, cols + fCols - 1);
 }
 
+TEST(transform, convolve_algorithms_CPU) {
+
+    unsigned int rows = 23;
+    unsigned int cols = 31;
+    DSmatrix<float, cpu_impl> myMatrix(rows, cols);
+    generate_random_values(myMatrix.data(), rows*cols, -1.0f, 1.0f);
+
+    // rank one (outer product, row, column) and full rank filters
+    std::vector<DSmatrix<float, cpu_impl>> filters;
+    DSmatrix<float, cpu_impl> u(5, 1), v(1, 7);
+    generate_random_values(u.data(), 5, -1.0f, 1.0f);
+    generate_random_values(v.data(), 7, -1.0f, 1.0f);
+    DSmatrix<float, cpu_impl> outer(5, 7);
+    matMul(u, v, outer);
+    filters.push_back(std::move(outer));
+    filters.push_back(std::move(v));
+    filters.push_back(std::move(u));
+    DSmatrix<float, cpu_impl> full(6, 5);
+    generate_random_values(full.data(), 30, -1.0f, 1.0f);
+    filters.push_back(std::move(full));
+
+    for (const DSmatrix<float, cpu_impl>& filter : filters) {
+
+        t_dims fDims = filter.dims();
+        t_dims outDims = convolve(myMatrix, filter);
+        DSmatrix<float, cpu_impl> reference(outDims.rows, outDims.cols, 0.0f);
+        for (unsigned int i = 0; i < rows; ++i)
+            for (unsigned int j = 0; j < cols; ++j)
+                for (unsigned int fi = 0; fi < fDims.rows; ++fi)
+                    for (unsigned int fj = 0; fj < fDims.cols; ++fj)
+                        reference(i+fi,j+fj) += myMatrix(i,j) * filter(fi,fj);
+
+        for (ConvAlgorithm algorithm : {CONV_AUTO, CONV_DIRECT, CONV_SEPARABLE, CONV_FFT}) {
+            DSmatrix<float, cpu_impl> result(outDims);
+            convolve(myMatrix, filter, &result, algorithm);
+            for (unsigned int k = 0; k < result.size(); ++k)
+                ASSERT_NEAR(result.data()[k], reference.data()[k], 1e-4)
+                    << fDims.rows << "x" << fDims.cols << " algorithm " << algorithm;
+        }
+    }
+}
+
 TEST(transform, real2complex_CPU) {
 
     unsigned int rows = 32;
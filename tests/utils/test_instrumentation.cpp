@@ -0,0 +1,90 @@
+/*
+ * @file test_instrumentation.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <vector>
+#include <atomic>
+
+#include "src/utils/instrumentation.hpp"
+#include "src/utils/threadPool.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(instrumentation, scope_CPU) {
+
+    std::vector<t_instrEvent> events;
+    Instrumentation instr([&](const t_instrEvent& event) {
+        events.push_back(event);
+    });
+
+    {
+        InstrScope scope(&instr, INSTR_FFT, 64, 3);
+    }
+    {
+        InstrScope scope(&instr, INSTR_FFT, 32);
+    }
+    // disabled probe
+    {
+        InstrScope scope(nullptr, INSTR_FFT, 16);
+    }
+
+    t_instrStats stats = instr.stats(INSTR_FFT);
+    ASSERT_EQ(stats.calls, 2);
+    ASSERT_EQ(stats.bytes, 96);
+    ASSERT_GE(stats.seconds, 0.0);
+    ASSERT_EQ(instr.stats(INSTR_IFFT).calls, 0);
+
+    ASSERT_EQ(events.size(), 2);
+    ASSERT_EQ(events[0].stage, INSTR_FFT);
+    ASSERT_EQ(events[0].index, 3);
+    ASSERT_EQ(events[0].bytes, 64);
+    ASSERT_EQ(events[1].index, -1);
+
+    instr.reset();
+    ASSERT_EQ(instr.stats(INSTR_FFT).calls, 0);
+    ASSERT_EQ(instr.stats(INSTR_FFT).bytes, 0);
+    ASSERT_STREQ(Instrumentation::stageName(INSTR_FILTERS), "filters");
+}
+
+TEST(instrumentation, concurrent_CPU) {
+
+    std::atomic<unsigned int> events(0);
+    Instrumentation instr([&](const t_instrEvent&) {
+        ++events;
+    });
+
+    ThreadPool pool(4);
+    pool.parallelFor(1000, [&](unsigned int i, unsigned int) {
+        instr.record(INSTR_CORRELATE, i, 1e-6, 8);
+    });
+
+    ASSERT_EQ(instr.stats(INSTR_CORRELATE).calls, 1000);
+    ASSERT_EQ(instr.stats(INSTR_CORRELATE).bytes, 8000);
+    ASSERT_NEAR(instr.stats(INSTR_CORRELATE).seconds, 1e-3, 1e-6);
+    ASSERT_EQ(events, 1000);
+}
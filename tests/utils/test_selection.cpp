@@ -0,0 +1,90 @@
+/*
+ * @file test_selection.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+#include "src/utils/selection.hpp"
+
+#include <gtest/gtest.h>
+
+// k-th smallest through both passes, the stream split in nWorkers parts
+template<typename T>
+T selectRank(const std::vector<T>& values, std::size_t k, unsigned int nWorkers) {
+
+    RankSelector<T> selector(k, nWorkers);
+    std::size_t part = (values.size() + nWorkers - 1) / nWorkers;
+    for (unsigned int w = 0; w < nWorkers; ++w) {
+        std::size_t begin = std::min(values.size(), w * part);
+        selector.count(values.data() + begin, std::min(part, values.size() - begin), w);
+    }
+    EXPECT_TRUE(selector.locate());
+    for (unsigned int w = 0; w < nWorkers; ++w) {
+        std::size_t begin = std::min(values.size(), w * part);
+        selector.collect(values.data() + begin, std::min(part, values.size() - begin), w);
+    }
+    return selector.select();
+}
+
+TEST(selection, rankSelector_CPU) {
+
+    std::mt19937 generator(7);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    std::vector<double> values(100000);
+    for (double& v : values)
+        v = std::abs(normal(generator));
+    std::vector<double> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+
+    for (std::size_t k : {std::size_t(0), std::size_t(1), values.size() / 2,
+                          values.size() - 2, values.size() - 1}) {
+        ASSERT_EQ(selectRank(values, k, 1), sorted[k]);
+        ASSERT_EQ(selectRank(values, k, 3), sorted[k]);
+    }
+
+    // ties, zeros, values beyond the logarithmic range and constant data
+    std::vector<float> skewed(50000, 1.0f);
+    for (std::size_t i = 0; i < 100; ++i)
+        skewed[i] = 1000.0f + i;
+    for (std::size_t i = 100; i < 200; ++i)
+        skewed[i] = 0.0f;
+    skewed[200] = 1e-30f;
+    skewed[201] = 1e30f;
+    std::vector<float> skewedSorted(skewed);
+    std::sort(skewedSorted.begin(), skewedSorted.end());
+    for (std::size_t k : {std::size_t(0), std::size_t(100), std::size_t(150),
+                          skewed.size() - 50, skewed.size() - 1})
+        ASSERT_EQ(selectRank(skewed, k, 2), skewedSorted[k]);
+
+    std::vector<float> constant(10, 2.5f);
+    ASSERT_EQ(selectRank(constant, 4, 1), 2.5f);
+}
@@ -0,0 +1,83 @@
+/*
+ * @file test_threadPool.cpp
+ *
+ * @copyright Copyright (C) 2024 Enrico Degregori <enrico.degregori@gmail.com>
+ *
+ * @author Enrico Degregori <enrico.degregori@gmail.com>
+ * 
+ * MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions: 
+ * 
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+
+#include "src/utils/threadPool.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(threadPool, parallelFor_CPU) {
+
+    unsigned int nThreads = 4;
+    unsigned int n = 1000;
+    ThreadPool pool(nThreads);
+    ASSERT_EQ(pool.size(), nThreads);
+
+    std::vector<unsigned int> visits(n, 0);
+    std::vector<unsigned int> workers(n, 0);
+    pool.parallelFor(n, [&](unsigned int i, unsigned int worker) {
+        visits[i] += 1;
+        workers[i] = worker;
+    });
+
+    for (unsigned int i = 0; i < n; ++i) {
+        ASSERT_EQ(visits[i], 1);
+        ASSERT_LT(workers[i], nThreads);
+    }
+}
+
+TEST(threadPool, nested_CPU) {
+
+    ThreadPool pool(4);
+    std::atomic<unsigned int> count(0);
+    pool.parallelFor(8, [&](unsigned int, unsigned int) {
+        pool.parallelFor(8, [&](unsigned int, unsigned int worker) {
+            ASSERT_EQ(worker, 0);
+            ++count;
+        });
+    });
+    ASSERT_EQ(count, 64);
+}
+
+TEST(threadPool, exception_CPU) {
+
+    ThreadPool pool(4);
+    ASSERT_THROW(pool.parallelFor(100, [&](unsigned int i, unsigned int) {
+        if (i == 42)
+            throw std::runtime_error("task failed");
+    }), std::runtime_error);
+
+    // the pool is still usable
+    std::atomic<unsigned int> count(0);
+    pool.parallelFor(100, [&](unsigned int, unsigned int) { ++count; });
+    ASSERT_EQ(count, 100);
+}